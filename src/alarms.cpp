@@ -0,0 +1,355 @@
+/*
+ * fridge - Fridge Controller
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fridge/alarms.h"
+
+#include <Arduino.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <limits>
+
+#include <uuid/common.h>
+#include <uuid/log.h>
+
+#include "app/config.h"
+#include "fridge/sensors.h"
+
+static const char __pstr__logger_name[] __attribute__((__aligned__(sizeof(int)))) PROGMEM = "alarms";
+
+namespace fridge {
+
+uuid::log::Logger Alarms::logger_{FPSTR(__pstr__logger_name), uuid::log::Facility::DAEMON};
+
+RTC_NOINIT_ATTR Alarms::Log Alarms::rtc_log_;
+
+/*
+ * Each event has its own checksum so that an event that was only partly
+ * written when the restart happened is discarded without losing the rest
+ * of the log.
+ */
+void Alarms::start() {
+	uint32_t last_sequence = 0;
+	unsigned int restored = 0;
+	unsigned int discarded = 0;
+
+	if (rtc_log_.magic != MAGIC) {
+		std::memset(&rtc_log_, 0, sizeof(rtc_log_));
+		rtc_log_.magic = MAGIC;
+	}
+
+	rtc_log_.boots++;
+
+	for (auto &event : rtc_log_.events) {
+		if (event.sequence == 0) {
+			continue;
+		}
+
+		if (event.checksum != checksum(event)) {
+			std::memset(&event, 0, sizeof(event));
+			discarded++;
+			continue;
+		}
+
+		last_sequence = std::max(last_sequence, event.sequence);
+		restored++;
+	}
+
+	next_sequence_ = last_sequence + 1;
+	last_reading_ms_ = millis();
+	configure_readings_timeout();
+
+	if (restored > 0 || discarded > 0) {
+		logger_.info(F("Restored %u events from RTC memory (%u discarded)"), restored, discarded);
+	}
+}
+
+/*
+ * Sensor readings are only evaluated when there's a new set of readings,
+ * which never happens if the bus has failed completely, so the absence of
+ * readings is checked on every loop pass.
+ */
+void Alarms::loop() {
+	if (!no_readings_ && millis() - last_reading_ms_ >= readings_timeout_ms_) {
+		no_readings_ = true;
+		unacknowledged_ = true;
+		logger_.alert(F("No valid temperature readings for %lus"),
+			(millis() - last_reading_ms_) / 1000);
+		append(Type::NO_READINGS_RAISED, 0, NAN);
+	}
+}
+
+void Alarms::update(const Sensors::Devices &devices) {
+	app::Config config;
+	unsigned long now_ms = millis();
+	float high_c = config.alarm_high_temperature();
+	float low_c = config.alarm_low_temperature();
+	float hysteresis_c = config.alarm_hysteresis();
+	unsigned long delay_ms = config.alarm_delay() * 1000;
+
+	configure_readings_timeout();
+
+	for (auto &sensor : sensors_) {
+		sensor.seen = false;
+	}
+
+	for (auto &device : devices) {
+		if (!std::isnan(device.temperature_c_)) {
+			last_reading_ms_ = now_ms;
+
+			if (no_readings_) {
+				no_readings_ = false;
+				logger_.notice(F("Valid temperature readings available"));
+				append(Type::NO_READINGS_CLEARED, 0, NAN);
+			}
+		}
+
+		Sensor *sensor = find(device.id());
+
+		if (!sensor) {
+			continue;
+		}
+
+		sensor->seen = true;
+		evaluate(*sensor, device, now_ms, high_c, low_c, hysteresis_c, delay_ms);
+	}
+
+	for (auto &sensor : sensors_) {
+		if (sensor.id == 0 || sensor.seen) {
+			continue;
+		}
+
+		if (sensor.high || sensor.low) {
+			logger_.alert(F("Sensor %s lost with an active alarm"),
+				Sensors::Device(sensor.id).to_string().c_str());
+			append(Type::SENSOR_LOST, sensor.id, NAN);
+		}
+
+		sensor = Sensor{};
+	}
+}
+
+void Alarms::configure_readings_timeout() {
+	app::Config config;
+
+	readings_timeout_ms_ = std::max(NO_READINGS_TIMEOUT_MS,
+		NO_READINGS_INTERVALS * config.sensors_slow_interval());
+}
+
+void Alarms::evaluate(Sensor &sensor, const Sensors::Device &device,
+		unsigned long now_ms, float high_c, float low_c,
+		float hysteresis_c, unsigned long delay_ms) {
+	float temperature_c = device.temperature_c_;
+
+	if (std::isnan(temperature_c)) {
+		return;
+	}
+
+	if (sensor.high) {
+		if (temperature_c <= high_c - hysteresis_c) {
+			sensor.high = false;
+			logger_.notice(F("Sensor %s temperature %.2fC no longer above %.2fC"),
+				device.to_string().c_str(), temperature_c, high_c);
+			append(Type::HIGH_CLEARED, sensor.id, temperature_c);
+		}
+	} else if (temperature_c > high_c) {
+		if (!sensor.high_pending) {
+			sensor.high_pending = true;
+			sensor.high_since_ms = now_ms;
+		}
+
+		if (now_ms - sensor.high_since_ms >= delay_ms) {
+			sensor.high_pending = false;
+			sensor.high = true;
+			unacknowledged_ = true;
+			logger_.alert(F("Sensor %s temperature %.2fC above %.2fC for %lus"),
+				device.to_string().c_str(), temperature_c, high_c,
+				(now_ms - sensor.high_since_ms) / 1000);
+			append(Type::HIGH_RAISED, sensor.id, temperature_c);
+		}
+	} else {
+		sensor.high_pending = false;
+	}
+
+	if (sensor.low) {
+		if (temperature_c >= low_c + hysteresis_c) {
+			sensor.low = false;
+			logger_.notice(F("Sensor %s temperature %.2fC no longer below %.2fC"),
+				device.to_string().c_str(), temperature_c, low_c);
+			append(Type::LOW_CLEARED, sensor.id, temperature_c);
+		}
+	} else if (temperature_c < low_c) {
+		if (!sensor.low_pending) {
+			sensor.low_pending = true;
+			sensor.low_since_ms = now_ms;
+		}
+
+		if (now_ms - sensor.low_since_ms >= delay_ms) {
+			sensor.low_pending = false;
+			sensor.low = true;
+			unacknowledged_ = true;
+			logger_.alert(F("Sensor %s temperature %.2fC below %.2fC for %lus"),
+				device.to_string().c_str(), temperature_c, low_c,
+				(now_ms - sensor.low_since_ms) / 1000);
+			append(Type::LOW_RAISED, sensor.id, temperature_c);
+		}
+	} else {
+		sensor.low_pending = false;
+	}
+}
+
+void Alarms::acknowledge() {
+	if (!unacknowledged_) {
+		return;
+	}
+
+	unacknowledged_ = false;
+	logger_.notice(F("Alarms acknowledged"));
+	append(Type::ACKNOWLEDGED, 0, NAN);
+}
+
+bool Alarms::buzzer() const {
+	return unacknowledged_;
+}
+
+unsigned int Alarms::active() const {
+	unsigned int count = 0;
+
+	for (auto &sensor : sensors_) {
+		if (sensor.high || sensor.low) {
+			count++;
+		}
+	}
+
+	if (no_readings_) {
+		count++;
+	}
+
+	return count;
+}
+
+bool Alarms::no_readings() const {
+	return no_readings_;
+}
+
+uint32_t Alarms::boot() const {
+	return rtc_log_.boots;
+}
+
+uint32_t Alarms::first_sequence() const {
+	return next_sequence_ > LOG_SIZE ? next_sequence_ - LOG_SIZE : 1;
+}
+
+uint32_t Alarms::next_sequence() const {
+	return next_sequence_;
+}
+
+const Alarms::Event *Alarms::event(uint32_t sequence) const {
+	const Event &event = rtc_log_.events[sequence % LOG_SIZE];
+
+	return (sequence != 0 && event.sequence == sequence) ? &event : nullptr;
+}
+
+Alarms::Sensor *Alarms::find(uint64_t id) {
+	Sensor *unused = nullptr;
+
+	for (auto &sensor : sensors_) {
+		if (sensor.id == id) {
+			return &sensor;
+		} else if (!unused && sensor.id == 0) {
+			unused = &sensor;
+		}
+	}
+
+	if (unused) {
+		unused->id = id;
+	}
+
+	return unused;
+}
+
+/*
+ * The checksum is written last so that the event is only valid once it
+ * has been completely written.
+ */
+void Alarms::append(Type type, uint64_t id, float temperature_c) {
+	Event &event = rtc_log_.events[next_sequence_ % LOG_SIZE];
+	time_t now = time(nullptr);
+
+	event.sequence = next_sequence_++;
+	event.boot = rtc_log_.boots;
+	event.time = now >= MINIMUM_TIME ? now : 0;
+	event.uptime_s = uuid::get_uptime_sec();
+	event.id = id;
+	if (std::isnan(temperature_c)) {
+		event.temperature_cc = std::numeric_limits<int16_t>::min();
+	} else {
+		event.temperature_cc = std::lround(temperature_c * 100);
+	}
+	event.type = type;
+	event.checksum = checksum(event);
+}
+
+uint32_t Alarms::checksum(const Event &event) {
+	uint32_t value = MAGIC;
+
+	value = (value * 31) ^ event.sequence;
+	value = (value * 31) ^ event.boot;
+	value = (value * 31) ^ event.time;
+	value = (value * 31) ^ event.uptime_s;
+	value = (value * 31) ^ (uint32_t)(event.id >> 32);
+	value = (value * 31) ^ (uint32_t)event.id;
+	value = (value * 31) ^ (uint16_t)event.temperature_cc;
+	value = (value * 31) ^ static_cast<uint8_t>(event.type);
+
+	return value;
+}
+
+const __FlashStringHelper *Alarms::type_name(Type type) {
+	switch (type) {
+	case Type::HIGH_RAISED:
+		return F("high");
+
+	case Type::HIGH_CLEARED:
+		return F("high cleared");
+
+	case Type::LOW_RAISED:
+		return F("low");
+
+	case Type::LOW_CLEARED:
+		return F("low cleared");
+
+	case Type::SENSOR_LOST:
+		return F("sensor lost");
+
+	case Type::ACKNOWLEDGED:
+		return F("acknowledged");
+
+	case Type::NO_READINGS_RAISED:
+		return F("no readings");
+
+	case Type::NO_READINGS_CLEARED:
+		return F("no readings cleared");
+	}
+
+	return F("unknown");
+}
+
+} // namespace fridge
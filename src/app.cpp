@@ -20,6 +20,7 @@
 
 #include <Arduino.h>
 
+#include <cmath>
 #include <memory>
 #include <vector>
 
@@ -32,11 +33,20 @@
 #include "app/config.h"
 #include "app/console.h"
 #include "app/network.h"
+#include "fridge/alarms.h"
+#include "fridge/compressor.h"
+#include "fridge/controller.h"
 #include "fridge/sensors.h"
 #include "fridge/door.h"
+#include "fridge/history.h"
+#include "fridge/multicast.h"
+#include "fridge/memory.h"
+#include "fridge/watchdog.h"
 
 static const char __pstr__enabled[] __attribute__((__aligned__(sizeof(int)))) PROGMEM = "enabled";
 static const char __pstr__disabled[] __attribute__((__aligned__(sizeof(int)))) PROGMEM = "disabled";
+static const char __pstr__auto[] __attribute__((__aligned__(sizeof(int)))) PROGMEM = "automatic";
+static const char __pstr__manual[] __attribute__((__aligned__(sizeof(int)))) PROGMEM = "manual";
 
 namespace fridge {
 
@@ -49,33 +59,219 @@ void App::start() {
 
 	app::App::start();
 
+	watchdog_.start();
+	alarms_.start();
+	compressor_.start();
 	relay(false);
 
 	sensors_.start(SENSOR_PIN);
 	door_.start(DOOR_PIN);
+	history_.start();
+	multicast_.start();
 
 	buzzer(false);
 }
 
 void App::loop() {
+	watchdog_.loop();
+
+	watchdog_.enter(Watchdog::Subsystem::APP);
 	app::App::loop();
 
+	Memory::loop();
+
+	watchdog_.enter(Watchdog::Subsystem::COMPRESSOR);
+	compressor_.loop();
+
+	watchdog_.enter(Watchdog::Subsystem::DOOR);
 	door_.loop();
+	sensors_.door_open(door_.open());
+
+	watchdog_.enter(Watchdog::Subsystem::SENSORS, static_cast<uint8_t>(sensors_.state()));
 	sensors_.loop();
+
+	if (relay_auto_) {
+		watchdog_.enter(Watchdog::Subsystem::CONTROL);
+		control();
+	}
+
+	watchdog_.enter(Watchdog::Subsystem::ALARMS);
+	check_alarms();
+
+	watchdog_.enter(Watchdog::Subsystem::HISTORY);
+	history_.loop(sensors_.devices());
+
+	watchdog_.enter(Watchdog::Subsystem::MULTICAST);
+	multicast_.loop(sensors_.devices(),
+		(compressor_.running() ? Multicast::FLAG_RELAY : 0)
+		| (relay_auto_ ? Multicast::FLAG_RELAY_AUTO : 0)
+		| (door_.open() ? Multicast::FLAG_DOOR_OPEN : 0)
+		| (alarms_.active() ? Multicast::FLAG_ALARM : 0)
+		| (alarms_.buzzer() ? Multicast::FLAG_ALARM_UNACKNOWLEDGED : 0));
+
+	watchdog_.enter(Watchdog::Subsystem::NONE);
+}
+
+/*
+ * A failed bus never completes a cycle, so the absence of readings is
+ * checked on every loop pass as well as when there's a new set of readings.
+ */
+void App::control() {
+	unsigned long generation = sensors_.generation();
+
+	if (alarms_.no_readings()) {
+		control_fail_safe();
+		return;
+	}
+
+	if (generation == control_generation_) {
+		return;
+	}
+
+	control_generation_ = generation;
+
+	float total_c = 0;
+	unsigned int count = 0;
+
+	for (auto& device : sensors_.devices()) {
+		if (!std::isnan(device.temperature_c_)) {
+			total_c += device.temperature_c_;
+			count++;
+		}
+	}
+
+	if (count == 0) {
+		control_fail_safe();
+		return;
+	}
+
+	if (control_failed_) {
+		logger_.notice(F("Temperature readings available, resuming control"));
+		control_failed_ = false;
+	}
+
+	app::Config config;
+	bool running = controller_.update(uuid::get_uptime_ms(), total_c / count,
+		compressor_.running(), config.minimum_temperature(),
+		config.maximum_temperature(), config.predictive_control());
+
+	if (running != compressor_.running()) {
+		relay(running);
+	}
+}
+
+void App::control_fail_safe() {
+	bool running = controller_.fail_safe(uuid::get_uptime_ms(),
+		compressor_.running(), compressor_.last_change_ms());
+
+	if (!control_failed_) {
+		logger_.alert(F("No valid temperature readings, stopping compressor"));
+		control_failed_ = true;
+	}
+
+	if (running != compressor_.running()) {
+		relay(running);
+	}
+}
+
+void App::check_alarms() {
+	unsigned long generation = sensors_.generation();
+
+	if (generation != alarms_generation_) {
+		alarms_generation_ = generation;
+		alarms_.update(sensors_.devices());
+	}
+
+	alarms_.loop();
+
+	if (alarms_.buzzer() != buzzer_) {
+		buzzer(alarms_.buzzer());
+	}
 }
 
 void App::relay(bool value) {
 	logger_.debug(F("Relay %S"), value ? __pstr__enabled : __pstr__disabled);
 	digitalWrite(RELAY_PIN, value ? HIGH : LOW);
+	compressor_.running(value);
+}
+
+void App::relay_auto(bool value) {
+	logger_.debug(F("Relay control %S"), value ? __pstr__auto : __pstr__manual);
+	relay_auto_ = value;
+}
+
+bool App::relay_auto() const {
+	return relay_auto_;
 }
 
 void App::buzzer(bool value) {
 	logger_.debug(F("Buzzer %S"), value ? __pstr__enabled : __pstr__disabled);
 	digitalWrite(BUZZER_PIN, value ? HIGH : LOW);
+	buzzer_ = value;
+}
+
+const Alarms &App::alarms() const {
+	return alarms_;
+}
+
+const History &App::history() const {
+	return history_;
+}
+
+void App::configure_multicast() {
+	multicast_.configure();
+}
+
+const Multicast &App::multicast() const {
+	return multicast_;
+}
+
+void App::acknowledge_alarms() {
+	alarms_.acknowledge();
+
+	if (alarms_.buzzer() != buzzer_) {
+		buzzer(alarms_.buzzer());
+	}
+}
+
+const Compressor &App::compressor() const {
+	return compressor_;
 }
 
-const std::vector<fridge::Sensors::Device> App::sensor_devices() {
+const Controller &App::controller() const {
+	return controller_;
+}
+
+void App::configure_watchdog() {
+	watchdog_.configure();
+}
+
+const Watchdog &App::watchdog() const {
+	return watchdog_;
+}
+
+void App::configure_sensors() {
+	sensors_.configure();
+}
+
+void App::sensor_trace(bool enabled) {
+	sensors_.trace(enabled);
+}
+
+const BusTrace &App::sensor_trace() const {
+	return sensors_.trace();
+}
+
+const Sensors &App::sensors() const {
+	return sensors_;
+}
+
+const Sensors::Devices &App::sensor_devices() const {
 	return sensors_.devices();
 }
 
+unsigned long App::sensor_generation() const {
+	return sensors_.generation();
+}
+
 } // namespace fridge
@@ -0,0 +1,105 @@
+/*
+ * fridge - Fridge Controller
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fridge/bus_trace.h"
+
+#include <Arduino.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "fridge/memory.h"
+
+namespace fridge {
+
+void BusTrace::enable(size_t size) {
+	buffer_.assign(size, 0);
+	buffer_.shrink_to_fit();
+	head_ = 0;
+	used_ = 0;
+	dropped_ = 0;
+}
+
+void BusTrace::disable() {
+	buffer_.clear();
+	buffer_.shrink_to_fit();
+	head_ = 0;
+	used_ = 0;
+}
+
+void BusTrace::record(Operation operation, unsigned long start_us, const uint8_t *data, size_t len) {
+	unsigned long duration_us = std::min(micros() - start_us, 0xFFFFUL);
+
+	len = std::min(len, MAX_DATA_LEN);
+
+	if (HEADER_LEN + len > buffer_.size()) {
+		return;
+	}
+
+	while (buffer_.size() - used_ < HEADER_LEN + len) {
+		size_t tail = (head_ + buffer_.size() - used_) % buffer_.size();
+
+		used_ -= HEADER_LEN + buffer_[(tail + 1) % buffer_.size()];
+		dropped_++;
+	}
+
+	put(static_cast<uint8_t>(operation));
+	put(len);
+	put(start_us);
+	put(start_us >> 8);
+	put(start_us >> 16);
+	put(start_us >> 24);
+	put(duration_us);
+	put(duration_us >> 8);
+
+	for (size_t i = 0; i < len; i++) {
+		put(data[i]);
+	}
+}
+
+void BusTrace::put(uint8_t value) {
+	buffer_[head_] = value;
+	head_ = (head_ + 1) % buffer_.size();
+	used_++;
+}
+
+size_t BusTrace::used() const {
+	return used_;
+}
+
+size_t BusTrace::read(size_t offset, uint8_t *data, size_t len) const {
+	if (offset >= used_) {
+		return 0;
+	}
+
+	size_t tail = (head_ + buffer_.size() - used_) % buffer_.size();
+
+	len = std::min(len, used_ - offset);
+
+	for (size_t i = 0; i < len; i++) {
+		data[i] = buffer_[(tail + offset + i) % buffer_.size()];
+	}
+
+	return len;
+}
+
+unsigned long BusTrace::dropped() const {
+	return dropped_;
+}
+
+} // namespace fridge
@@ -0,0 +1,218 @@
+/*
+ * fridge - Fridge Controller
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fridge/compressor.h"
+
+#include <Arduino.h>
+#include <Preferences.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include <uuid/common.h>
+#include <uuid/log.h>
+
+#include "app/config.h"
+
+static const char __pstr__logger_name[] __attribute__((__aligned__(sizeof(int)))) PROGMEM = "compressor";
+static const char __pstr__preferences_name[] __attribute__((__aligned__(sizeof(int)))) PROGMEM = "compressor";
+static const char __pstr__preferences_runtime[] __attribute__((__aligned__(sizeof(int)))) PROGMEM = "runtime";
+static const char __pstr__preferences_cycles[] __attribute__((__aligned__(sizeof(int)))) PROGMEM = "cycles";
+static const char __pstr__preferences_energy[] __attribute__((__aligned__(sizeof(int)))) PROGMEM = "energy";
+
+namespace fridge {
+
+constexpr std::array<unsigned int,Compressor::WINDOWS> Compressor::WINDOW_MINUTES;
+
+uuid::log::Logger Compressor::logger_{FPSTR(__pstr__logger_name), uuid::log::Facility::DAEMON};
+
+void Compressor::start() {
+	load();
+
+	uint64_t now_ms = uuid::get_uptime_ms();
+
+	accounted_ms_ = now_ms;
+	bucket_start_ms_ = now_ms;
+	last_save_ms_ = now_ms;
+}
+
+void Compressor::loop() {
+	uint64_t now_ms = uuid::get_uptime_ms();
+
+	while (now_ms - bucket_start_ms_ >= BUCKET_MS) {
+		uint64_t bucket_end_ms = bucket_start_ms_ + BUCKET_MS;
+
+		accumulate(bucket_end_ms);
+		buckets_[bucket_] = bucket_running_ms_ / 1000;
+		bucket_ = (bucket_ + 1) % BUCKETS;
+		buckets_filled_ = std::min(buckets_filled_ + 1, BUCKETS);
+
+		bucket_running_ms_ = 0;
+		bucket_start_ms_ = bucket_end_ms;
+	}
+
+	if (now_ms - last_save_ms_ >= SAVE_INTERVAL_MS) {
+		accumulate(now_ms);
+		save();
+
+		logger_.info(F("Cycles %lu, runtime %lus, duty %.1f%%/%.1f%%/%.1f%%, energy %.3fkWh"),
+			cycles_, (unsigned long)(runtime_ms_ / 1000),
+			duty_cycle(0) * 100, duty_cycle(1) * 100, duty_cycle(2) * 100,
+			energy_kwh());
+
+		last_save_ms_ = now_ms;
+	}
+}
+
+void Compressor::running(bool value) {
+	if (value == running_) {
+		return;
+	}
+
+	uint64_t now_ms = uuid::get_uptime_ms();
+
+	accumulate(now_ms);
+
+	if (value) {
+		if (last_change_ms_ != 0) {
+			last_rest_ms_ = now_ms - last_change_ms_;
+		}
+		cycles_++;
+	} else {
+		last_run_ms_ = now_ms - last_change_ms_;
+	}
+
+	running_ = value;
+	last_change_ms_ = now_ms;
+}
+
+bool Compressor::running() const {
+	return running_;
+}
+
+uint64_t Compressor::last_change_ms() const {
+	return last_change_ms_;
+}
+
+uint64_t Compressor::last_run_ms() const {
+	return last_run_ms_;
+}
+
+uint64_t Compressor::last_rest_ms() const {
+	return last_rest_ms_;
+}
+
+unsigned long Compressor::cycles() const {
+	return cycles_;
+}
+
+uint64_t Compressor::runtime_ms() const {
+	uint64_t runtime_ms = runtime_ms_;
+
+	if (running_) {
+		runtime_ms += uuid::get_uptime_ms() - accounted_ms_;
+	}
+
+	return runtime_ms;
+}
+
+/*
+ * The current partial bucket is included, so the window may extend up to
+ * one bucket further back than its nominal length.
+ */
+float Compressor::duty_cycle(unsigned int window) const {
+	uint64_t now_ms = uuid::get_uptime_ms();
+	size_t count = std::min((size_t)(WINDOW_MINUTES[window] * 60 * 1000UL / BUCKET_MS), buckets_filled_);
+	uint64_t running_ms = bucket_running_ms_;
+	uint64_t elapsed_ms = now_ms - bucket_start_ms_ + count * BUCKET_MS;
+
+	if (running_) {
+		running_ms += now_ms - accounted_ms_;
+	}
+
+	for (size_t i = 1; i <= count; i++) {
+		running_ms += buckets_[(bucket_ + BUCKETS - i) % BUCKETS] * 1000UL;
+	}
+
+	if (elapsed_ms == 0) {
+		return NAN;
+	}
+
+	return (float)running_ms / elapsed_ms;
+}
+
+/*
+ * Energy that has already been accounted for keeps the power rating that
+ * was in effect at the time, only the unaccounted part of the current run
+ * uses the current power rating.
+ */
+float Compressor::energy_kwh() const {
+	uint64_t energy_mj = energy_mj_;
+
+	if (running_) {
+		app::Config config;
+
+		energy_mj += std::llround((uuid::get_uptime_ms() - accounted_ms_) * config.compressor_power());
+	}
+
+	return energy_mj / 3600000000.0f;
+}
+
+/*
+ * Running time is accounted for when the compressor stops and at least
+ * every bucket while it is running, so a change to the power rating only
+ * applies to running time from the last bucket onwards.
+ */
+void Compressor::accumulate(uint64_t now_ms) {
+	if (running_) {
+		app::Config config;
+		uint64_t elapsed_ms = now_ms - accounted_ms_;
+
+		bucket_running_ms_ += elapsed_ms;
+		runtime_ms_ += elapsed_ms;
+		energy_mj_ += std::llround(elapsed_ms * config.compressor_power());
+	}
+
+	accounted_ms_ = now_ms;
+}
+
+void Compressor::load() {
+	Preferences preferences;
+
+	if (preferences.begin(__pstr__preferences_name, true)) {
+		runtime_ms_ = preferences.getULong64(__pstr__preferences_runtime, 0);
+		cycles_ = preferences.getULong(__pstr__preferences_cycles, 0);
+		energy_mj_ = preferences.getULong64(__pstr__preferences_energy, 0);
+		preferences.end();
+	}
+}
+
+void Compressor::save() {
+	Preferences preferences;
+
+	if (preferences.begin(__pstr__preferences_name, false)) {
+		preferences.putULong64(__pstr__preferences_runtime, runtime_ms_);
+		preferences.putULong(__pstr__preferences_cycles, cycles_);
+		preferences.putULong64(__pstr__preferences_energy, energy_mj_);
+		preferences.end();
+	} else {
+		logger_.err(F("Unable to save totals"));
+	}
+}
+
+} // namespace fridge
@@ -18,6 +18,7 @@
 
 #include "app/config.h"
 
+#include <algorithm>
 #include <cmath>
 
 namespace app {
@@ -64,4 +65,167 @@ bool Config::maximum_temperature(float temperature, bool load) {
 	}
 }
 
+bool Config::sensors_fast_interval(unsigned long interval_ms, bool load) {
+	if (interval_ms == 0) {
+		if (load) {
+			interval_ms = DEFAULT_SENSORS_FAST_INTERVAL_MS;
+		} else {
+			return false;
+		}
+	}
+
+	interval_ms = std::max(interval_ms, MINIMUM_SENSORS_INTERVAL_MS);
+	interval_ms = std::min(interval_ms, MAXIMUM_SENSORS_INTERVAL_MS);
+	sensors_fast_interval_ = interval_ms;
+
+	if (sensors_slow_interval_ != 0 && sensors_slow_interval_ < sensors_fast_interval_) {
+		sensors_slow_interval_ = sensors_fast_interval_;
+		return true;
+	} else {
+		return false;
+	}
+}
+
+bool Config::sensors_slow_interval(unsigned long interval_ms, bool load) {
+	if (interval_ms == 0) {
+		if (load) {
+			interval_ms = DEFAULT_SENSORS_SLOW_INTERVAL_MS;
+		} else {
+			return false;
+		}
+	}
+
+	interval_ms = std::max(interval_ms, MINIMUM_SENSORS_INTERVAL_MS);
+	interval_ms = std::min(interval_ms, MAXIMUM_SENSORS_INTERVAL_MS);
+	sensors_slow_interval_ = interval_ms;
+
+	if (sensors_fast_interval_ > sensors_slow_interval_) {
+		sensors_fast_interval_ = sensors_slow_interval_;
+		return true;
+	} else {
+		return false;
+	}
+}
+
+bool Config::sensors_summary_interval(unsigned long interval_ms, bool load __attribute__((unused))) {
+	sensors_summary_interval_ = std::min(interval_ms, MAXIMUM_SENSORS_INTERVAL_MS);
+	return false;
+}
+
+bool Config::sensors_verbose(bool enabled, bool load __attribute__((unused))) {
+	sensors_verbose_ = enabled;
+	return false;
+}
+
+bool Config::sensors_short_read(bool enabled, bool load __attribute__((unused))) {
+	sensors_short_read_ = enabled;
+	return false;
+}
+
+bool Config::compressor_power(float power, bool load) {
+	if (!std::isfinite(power)) {
+		if (load) {
+			power = DEFAULT_COMPRESSOR_POWER_W;
+		} else {
+			return false;
+		}
+	}
+
+	power = std::max(power, 0.0f);
+	power = std::min(power, MAXIMUM_COMPRESSOR_POWER_W);
+	compressor_power_ = power;
+	return false;
+}
+
+bool Config::predictive_control(bool enabled, bool load __attribute__((unused))) {
+	predictive_control_ = enabled;
+	return false;
+}
+
+bool Config::watchdog_timeout(unsigned long timeout_ms, bool load __attribute__((unused))) {
+	if (timeout_ms != 0) {
+		timeout_ms = std::max(timeout_ms, MINIMUM_WATCHDOG_TIMEOUT_MS);
+		timeout_ms = std::min(timeout_ms, MAXIMUM_WATCHDOG_TIMEOUT_MS);
+	}
+
+	watchdog_timeout_ = timeout_ms;
+	return false;
+}
+
+bool Config::alarm_high_temperature(float temperature, bool load) {
+	if (!std::isfinite(temperature)) {
+		if (load) {
+			temperature = DEFAULT_ALARM_HIGH_TEMPERATURE_C;
+		} else {
+			return false;
+		}
+	}
+
+	temperature = std::max(temperature, MINIMUM_TEMPERATURE_C);
+	temperature = std::min(temperature, MAXIMUM_TEMPERATURE_C);
+
+	/* The pair is checked when the low alarm is loaded */
+	if (!load && temperature <= alarm_low_temperature_) {
+		return false;
+	}
+
+	alarm_high_temperature_ = temperature;
+	return false;
+}
+
+bool Config::alarm_low_temperature(float temperature, bool load) {
+	if (!std::isfinite(temperature)) {
+		if (load) {
+			temperature = DEFAULT_ALARM_LOW_TEMPERATURE_C;
+		} else {
+			return false;
+		}
+	}
+
+	temperature = std::max(temperature, MINIMUM_TEMPERATURE_C);
+	temperature = std::min(temperature, MAXIMUM_TEMPERATURE_C);
+
+	/*
+	 * The high alarm is loaded first, so if the stored pair is inconsistent
+	 * then both are replaced with the defaults.
+	 */
+	if (temperature >= alarm_high_temperature_) {
+		if (!load) {
+			return false;
+		}
+
+		alarm_low_temperature_ = DEFAULT_ALARM_LOW_TEMPERATURE_C;
+		alarm_high_temperature_ = DEFAULT_ALARM_HIGH_TEMPERATURE_C;
+		return true;
+	}
+
+	alarm_low_temperature_ = temperature;
+	return false;
+}
+
+bool Config::alarm_hysteresis(float temperature, bool load) {
+	if (!std::isfinite(temperature)) {
+		if (load) {
+			temperature = DEFAULT_ALARM_HYSTERESIS_C;
+		} else {
+			return false;
+		}
+	}
+
+	temperature = std::max(temperature, 0.0f);
+	temperature = std::min(temperature, MAXIMUM_ALARM_HYSTERESIS_C);
+	alarm_hysteresis_ = temperature;
+	return false;
+}
+
+bool Config::alarm_delay(unsigned long delay_s, bool load __attribute__((unused))) {
+	alarm_delay_ = std::min(delay_s, MAXIMUM_ALARM_DELAY_S);
+	return false;
+}
+
+bool Config::multicast_status(bool enabled, bool load __attribute__((unused))) {
+	multicast_status_ = enabled;
+	return false;
+}
+
 } // namespace app
@@ -23,7 +23,20 @@
 
 #define MCU_APP_CONFIG_DATA \
 		MCU_APP_CONFIG_CUSTOM(float, "", minimum_temperature, "_c", static_cast<float>(DEFAULT_MINIMUM_TEMPERATURE_C), true) \
-		MCU_APP_CONFIG_CUSTOM(float, "", maximum_temperature, "_c", static_cast<float>(DEFAULT_MAXIMUM_TEMPERATURE_C), true)
+		MCU_APP_CONFIG_CUSTOM(float, "", maximum_temperature, "_c", static_cast<float>(DEFAULT_MAXIMUM_TEMPERATURE_C), true) \
+		MCU_APP_CONFIG_CUSTOM(unsigned long, "", sensors_fast_interval, "_ms", static_cast<unsigned long>(DEFAULT_SENSORS_FAST_INTERVAL_MS), true) \
+		MCU_APP_CONFIG_CUSTOM(unsigned long, "", sensors_slow_interval, "_ms", static_cast<unsigned long>(DEFAULT_SENSORS_SLOW_INTERVAL_MS), true) \
+		MCU_APP_CONFIG_CUSTOM(unsigned long, "", sensors_summary_interval, "_ms", static_cast<unsigned long>(DEFAULT_SENSORS_SUMMARY_INTERVAL_MS), true) \
+		MCU_APP_CONFIG_CUSTOM(bool, "", sensors_verbose, "", DEFAULT_SENSORS_VERBOSE, true) \
+		MCU_APP_CONFIG_CUSTOM(bool, "", sensors_short_read, "", DEFAULT_SENSORS_SHORT_READ, true) \
+		MCU_APP_CONFIG_CUSTOM(float, "", compressor_power, "_w", static_cast<float>(DEFAULT_COMPRESSOR_POWER_W), true) \
+		MCU_APP_CONFIG_CUSTOM(bool, "", predictive_control, "", DEFAULT_PREDICTIVE_CONTROL, true) \
+		MCU_APP_CONFIG_CUSTOM(unsigned long, "", watchdog_timeout, "_ms", static_cast<unsigned long>(DEFAULT_WATCHDOG_TIMEOUT_MS), true) \
+		MCU_APP_CONFIG_CUSTOM(float, "", alarm_high_temperature, "_c", static_cast<float>(DEFAULT_ALARM_HIGH_TEMPERATURE_C), true) \
+		MCU_APP_CONFIG_CUSTOM(float, "", alarm_low_temperature, "_c", static_cast<float>(DEFAULT_ALARM_LOW_TEMPERATURE_C), true) \
+		MCU_APP_CONFIG_CUSTOM(float, "", alarm_hysteresis, "_c", static_cast<float>(DEFAULT_ALARM_HYSTERESIS_C), true) \
+		MCU_APP_CONFIG_CUSTOM(unsigned long, "", alarm_delay, "_s", static_cast<unsigned long>(DEFAULT_ALARM_DELAY_S), true) \
+		MCU_APP_CONFIG_CUSTOM(bool, "", multicast_status, "", DEFAULT_MULTICAST_STATUS, true)
 
 public:
 	float minimum_temperature() const;
@@ -32,12 +45,84 @@ public:
 	float maximum_temperature() const;
 	bool maximum_temperature(float temperature, bool load = false);
 
+	unsigned long sensors_fast_interval() const;
+	bool sensors_fast_interval(unsigned long interval_ms, bool load = false);
+
+	unsigned long sensors_slow_interval() const;
+	bool sensors_slow_interval(unsigned long interval_ms, bool load = false);
+
+	unsigned long sensors_summary_interval() const;
+	bool sensors_summary_interval(unsigned long interval_ms, bool load = false);
+
+	bool sensors_verbose() const;
+	bool sensors_verbose(bool enabled, bool load = false);
+
+	bool sensors_short_read() const;
+	bool sensors_short_read(bool enabled, bool load = false);
+
+	float compressor_power() const;
+	bool compressor_power(float power, bool load = false);
+
+	bool predictive_control() const;
+	bool predictive_control(bool enabled, bool load = false);
+
+	unsigned long watchdog_timeout() const;
+	bool watchdog_timeout(unsigned long timeout_ms, bool load = false);
+
+	float alarm_high_temperature() const;
+	bool alarm_high_temperature(float temperature, bool load = false);
+
+	float alarm_low_temperature() const;
+	bool alarm_low_temperature(float temperature, bool load = false);
+
+	float alarm_hysteresis() const;
+	bool alarm_hysteresis(float temperature, bool load = false);
+
+	unsigned long alarm_delay() const;
+	bool alarm_delay(unsigned long delay_s, bool load = false);
+
+	bool multicast_status() const;
+	bool multicast_status(bool enabled, bool load = false);
+
 private:
 	static constexpr float MINIMUM_TEMPERATURE_C = -40.0f;
 	static constexpr float MAXIMUM_TEMPERATURE_C = 40.0f;
 	static constexpr float DEFAULT_MINIMUM_TEMPERATURE_C = 3.0f;
 	static constexpr float DEFAULT_MAXIMUM_TEMPERATURE_C = 5.0f;
 	static constexpr float DEFAULT_TEMPERATURE_DIFFERENTIAL_C = 2.0f;
+	static constexpr unsigned long MINIMUM_SENSORS_INTERVAL_MS = 100;
+	static constexpr unsigned long MAXIMUM_SENSORS_INTERVAL_MS = 3600000;
+	static constexpr unsigned long DEFAULT_SENSORS_FAST_INTERVAL_MS = 1000;
+	static constexpr unsigned long DEFAULT_SENSORS_SLOW_INTERVAL_MS = 30000;
+	static constexpr unsigned long DEFAULT_SENSORS_SUMMARY_INTERVAL_MS = 60000;
+	static constexpr bool DEFAULT_SENSORS_VERBOSE = false;
+	static constexpr bool DEFAULT_SENSORS_SHORT_READ = false;
+	static constexpr float MAXIMUM_COMPRESSOR_POWER_W = 5000.0f;
+	static constexpr float DEFAULT_COMPRESSOR_POWER_W = 100.0f;
+	static constexpr bool DEFAULT_PREDICTIVE_CONTROL = false;
+	static constexpr unsigned long MINIMUM_WATCHDOG_TIMEOUT_MS = 1000;
+	static constexpr unsigned long MAXIMUM_WATCHDOG_TIMEOUT_MS = 600000;
+	static constexpr unsigned long DEFAULT_WATCHDOG_TIMEOUT_MS = 10000;
+	static constexpr float DEFAULT_ALARM_HIGH_TEMPERATURE_C = 8.0f;
+	static constexpr float DEFAULT_ALARM_LOW_TEMPERATURE_C = 0.0f;
+	static constexpr float MAXIMUM_ALARM_HYSTERESIS_C = 10.0f;
+	static constexpr float DEFAULT_ALARM_HYSTERESIS_C = 1.0f;
+	static constexpr unsigned long MAXIMUM_ALARM_DELAY_S = 86400;
+	static constexpr unsigned long DEFAULT_ALARM_DELAY_S = 600;
+	static constexpr bool DEFAULT_MULTICAST_STATUS = false;
 
 	static float minimum_temperature_;
 	static float maximum_temperature_;
+	static unsigned long sensors_fast_interval_;
+	static unsigned long sensors_slow_interval_;
+	static unsigned long sensors_summary_interval_;
+	static bool sensors_verbose_;
+	static bool sensors_short_read_;
+	static float compressor_power_;
+	static bool predictive_control_;
+	static unsigned long watchdog_timeout_;
+	static float alarm_high_temperature_;
+	static float alarm_low_temperature_;
+	static float alarm_hysteresis_;
+	static unsigned long alarm_delay_;
+	static bool multicast_status_;
@@ -18,15 +18,28 @@
 
 #include "fridge/console.h"
 
+#include <Arduino.h>
+
+#include <algorithm>
+#include <cmath>
+#include <ctime>
 #include <limits>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include <uuid/common.h>
 #include <uuid/console.h>
 #include <uuid/log.h>
 
+#include "fridge/alarms.h"
 #include "fridge/app.h"
+#include "fridge/bus_trace.h"
+#include "fridge/compressor.h"
+#include "fridge/memory.h"
+#include "fridge/multicast.h"
+#include "fridge/sensors.h"
+#include "fridge/watchdog.h"
 #include "app/config.h"
 #include "app/console.h"
 
@@ -49,30 +62,74 @@ namespace fridge {
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic error "-Wunused-const-variable"
+MAKE_PSTR_WORD(acknowledge)
+MAKE_PSTR_WORD(alarm)
+MAKE_PSTR_WORD(alarms)
 MAKE_PSTR_WORD(auto)
+MAKE_PSTR_WORD(compressor)
+MAKE_PSTR_WORD(control)
+MAKE_PSTR_WORD(delay)
 MAKE_PSTR_WORD(delete)
 MAKE_PSTR_WORD(exit)
+MAKE_PSTR_WORD(export)
 MAKE_PSTR_WORD(external)
+MAKE_PSTR_WORD(fast)
+MAKE_PSTR_WORD(fridges)
 MAKE_PSTR_WORD(help)
+MAKE_PSTR_WORD(history)
+MAKE_PSTR_WORD(high)
+MAKE_PSTR_WORD(hysteresis)
 MAKE_PSTR_WORD(internal)
+MAKE_PSTR_WORD(interval)
 MAKE_PSTR_WORD(logout)
+MAKE_PSTR_WORD(low)
 MAKE_PSTR_WORD(minimum)
+MAKE_PSTR_WORD(multicast)
 MAKE_PSTR_WORD(maximum)
+MAKE_PSTR_WORD(memory)
 MAKE_PSTR_WORD(name)
 MAKE_PSTR_WORD(off)
 MAKE_PSTR_WORD(on)
+MAKE_PSTR_WORD(power)
+MAKE_PSTR_WORD(predictive)
 MAKE_PSTR_WORD(relay)
 MAKE_PSTR_WORD(sensor)
 MAKE_PSTR_WORD(sensors)
 MAKE_PSTR_WORD(set)
 MAKE_PSTR_WORD(show)
+MAKE_PSTR_WORD(slow)
+MAKE_PSTR_WORD(timeout)
+MAKE_PSTR_WORD(trace)
+MAKE_PSTR_WORD(summary)
 MAKE_PSTR_WORD(type)
 MAKE_PSTR_WORD(unknown)
+MAKE_PSTR_WORD(verbose)
+MAKE_PSTR_WORD(watch)
+MAKE_PSTR_WORD(watchdog)
 MAKE_PSTR(celsius_mandatory, "<°C>")
 MAKE_PSTR(id_mandatory, "<id>")
+MAKE_PSTR(milliseconds_mandatory, "<ms>")
+MAKE_PSTR(seconds_mandatory, "<seconds>")
+MAKE_PSTR(short_read, "short-read")
+MAKE_PSTR(watts_mandatory, "<W>")
 MAKE_PSTR(minimum_temperature_fmt, "Minimum temperature = %.2f°C");
 MAKE_PSTR(maximum_temperature_fmt, "Maximum temperature = %.2f°C");
+MAKE_PSTR(milliseconds_optional, "[ms]")
 MAKE_PSTR(name_optional, "[name]")
+MAKE_PSTR(fast_interval_fmt, "Fast sample interval = %lums");
+MAKE_PSTR(slow_interval_fmt, "Slow sample interval = %lums");
+MAKE_PSTR(summary_interval_fmt, "Scan summary interval = %lums");
+MAKE_PSTR(sensors_verbose_fmt, "Log every sensor reading = %S");
+MAKE_PSTR(sensors_short_read_fmt, "Short scratchpad reads = %S");
+MAKE_PSTR(compressor_power_fmt, "Compressor power = %.0fW");
+MAKE_PSTR(control_mode_fmt, "Control mode = %S");
+MAKE_PSTR(watchdog_timeout_fmt, "Watchdog timeout = %lums");
+MAKE_PSTR(alarm_high_fmt, "High temperature alarm = %.2f°C");
+MAKE_PSTR(alarm_low_fmt, "Low temperature alarm = %.2f°C");
+MAKE_PSTR(alarm_hysteresis_fmt, "Alarm hysteresis = %.2f°C");
+MAKE_PSTR(alarm_delay_fmt, "Alarm delay = %lus");
+MAKE_PSTR(multicast_status_fmt, "Multicast status = %S");
+MAKE_PSTR(sensor_temperature_fmt, ": %.2fC")
 #pragma GCC diagnostic pop
 
 static inline App &to_app(Shell &shell) {
@@ -85,20 +142,100 @@ static inline FridgeShell &to_shell(Shell &shell) {
 
 #define NO_ARGUMENTS std::vector<std::string>{}
 
+static void set_sensors_verbose(Shell &shell, bool enabled) {
+	Config config;
+	config.sensors_verbose(enabled);
+	config.commit();
+	to_app(shell).configure_sensors();
+
+	shell.printfln(F_(sensors_verbose_fmt), config.sensors_verbose() ? F_(on) : F_(off));
+}
+
+static void set_sensors_short_read(Shell &shell, bool enabled) {
+	Config config;
+	config.sensors_short_read(enabled);
+	config.commit();
+	to_app(shell).configure_sensors();
+
+	shell.printfln(F_(sensors_short_read_fmt), config.sensors_short_read() ? F_(on) : F_(off));
+}
+
+static void set_multicast(Shell &shell, bool enabled) {
+	Config config;
+	config.multicast_status(enabled);
+	config.commit();
+	to_app(shell).configure_multicast();
+
+	shell.printfln(F_(multicast_status_fmt), config.multicast_status() ? F_(on) : F_(off));
+}
+
+static void show_fridge(Shell &shell, const Multicast::Peer &peer) {
+	std::array<char, Multicast::MAX_SENSORS * 8 + 1> temperatures;
+	std::array<char, 16> address;
+	IPAddress ip{peer.address};
+	size_t len = 0;
+
+	::snprintf_P(address.data(), address.size(), PSTR("%u.%u.%u.%u"), ip[0], ip[1], ip[2], ip[3]);
+
+	temperatures[0] = '\0';
+	for (size_t i = 0; i < peer.sensor_count; i++) {
+		if (peer.temperatures[i] == Multicast::UNKNOWN_TEMPERATURE) {
+			len += std::max(0, ::snprintf_P(&temperatures[len], temperatures.size() - len, PSTR(" -")));
+		} else {
+			len += std::max(0, ::snprintf_P(&temperatures[len], temperatures.size() - len, PSTR(" %.2f"), peer.temperatures[i] / 16.0f));
+		}
+		len = std::min(len, temperatures.size() - 1);
+	}
+
+	shell.printfln(F("%-16s %-15s %5lus %-5S %-6S %-5S %5lu%s"),
+		peer.hostname, address.data(),
+		(millis() - peer.last_seen_ms) / 1000,
+		(peer.flags & Multicast::FLAG_RELAY) ? F_(on) : F_(off),
+		(peer.flags & Multicast::FLAG_DOOR_OPEN) ? F("open") : F("closed"),
+		(peer.flags & Multicast::FLAG_ALARM_UNACKNOWLEDGED) ? F("new")
+			: ((peer.flags & Multicast::FLAG_ALARM) ? F("on") : F("-")),
+		peer.lost, temperatures.data());
+}
+
 static inline void setup_commands(std::shared_ptr<Commands> &commands) {
+	commands->add_command(ShellContext::MAIN, CommandFlags::ADMIN, flash_string_vector{F_(alarms), F_(acknowledge)},
+			[] (Shell &shell, const std::vector<std::string> &arguments __attribute__((unused))) {
+		to_app(shell).acknowledge_alarms();
+	});
+
 	commands->add_command(ShellContext::MAIN, CommandFlags::ADMIN, flash_string_vector{F_(relay), F_(on)},
-			[] (Shell &shell __attribute__((unused)), const std::vector<std::string> &arguments __attribute__((unused))) {
+			[] (Shell &shell, const std::vector<std::string> &arguments __attribute__((unused))) {
+		to_app(shell).relay_auto(false);
 		to_app(shell).relay(true);
 	});
 
 	commands->add_command(ShellContext::MAIN, CommandFlags::ADMIN, flash_string_vector{F_(relay), F_(off)},
-			[] (Shell &shell __attribute__((unused)), const std::vector<std::string> &arguments __attribute__((unused))) {
+			[] (Shell &shell, const std::vector<std::string> &arguments __attribute__((unused))) {
+		to_app(shell).relay_auto(false);
 		to_app(shell).relay(false);
 	});
 
 	commands->add_command(ShellContext::MAIN, CommandFlags::ADMIN, flash_string_vector{F_(relay), F_(auto)},
-			[] (Shell &shell __attribute__((unused)), const std::vector<std::string> &arguments __attribute__((unused))) {
+			[] (Shell &shell, const std::vector<std::string> &arguments __attribute__((unused))) {
+		to_app(shell).relay_auto(true);
+	});
 
+	commands->add_command(ShellContext::MAIN, CommandFlags::ADMIN, flash_string_vector{F_(set), F_(control), F_(hysteresis)},
+			[] (Shell &shell, const std::vector<std::string> &arguments __attribute__((unused))) {
+		Config config;
+		config.predictive_control(false);
+		config.commit();
+
+		shell.printfln(F_(control_mode_fmt), F_(hysteresis));
+	});
+
+	commands->add_command(ShellContext::MAIN, CommandFlags::ADMIN, flash_string_vector{F_(set), F_(control), F_(predictive)},
+			[] (Shell &shell, const std::vector<std::string> &arguments __attribute__((unused))) {
+		Config config;
+		config.predictive_control(true);
+		config.commit();
+
+		shell.printfln(F_(control_mode_fmt), F_(predictive));
 	});
 
 	commands->add_command(ShellContext::MAIN, CommandFlags::ADMIN, flash_string_vector{F_(set), F_(minimum)}, flash_string_vector{F_(celsius_mandatory)},
@@ -125,23 +262,372 @@ static inline void setup_commands(std::shared_ptr<Commands> &commands) {
 		shell.printfln(F_(maximum_temperature_fmt), config.maximum_temperature());
 	});
 
+	commands->add_command(ShellContext::MAIN, CommandFlags::ADMIN, flash_string_vector{F_(set), F_(interval), F_(fast)}, flash_string_vector{F_(milliseconds_mandatory)},
+			[] (Shell &shell, const std::vector<std::string> &arguments) {
+		Config config;
+		bool slow_changed = config.sensors_fast_interval(String(arguments.front().c_str()).toInt());
+		config.commit();
+		to_app(shell).configure_sensors();
+
+		shell.printfln(F_(fast_interval_fmt), config.sensors_fast_interval());
+		if (slow_changed) {
+			shell.printfln(F_(slow_interval_fmt), config.sensors_slow_interval());
+		}
+	});
+
+	commands->add_command(ShellContext::MAIN, CommandFlags::ADMIN, flash_string_vector{F_(set), F_(interval), F_(slow)}, flash_string_vector{F_(milliseconds_mandatory)},
+			[] (Shell &shell, const std::vector<std::string> &arguments) {
+		Config config;
+		bool fast_changed = config.sensors_slow_interval(String(arguments.front().c_str()).toInt());
+		config.commit();
+		to_app(shell).configure_sensors();
+
+		if (fast_changed) {
+			shell.printfln(F_(fast_interval_fmt), config.sensors_fast_interval());
+		}
+		shell.printfln(F_(slow_interval_fmt), config.sensors_slow_interval());
+	});
+
+	commands->add_command(ShellContext::MAIN, CommandFlags::ADMIN, flash_string_vector{F_(set), F_(interval), F_(summary)}, flash_string_vector{F_(milliseconds_mandatory)},
+			[] (Shell &shell, const std::vector<std::string> &arguments) {
+		Config config;
+		config.sensors_summary_interval(String(arguments.front().c_str()).toInt());
+		config.commit();
+		to_app(shell).configure_sensors();
+
+		shell.printfln(F_(summary_interval_fmt), config.sensors_summary_interval());
+	});
+
+	commands->add_command(ShellContext::MAIN, CommandFlags::ADMIN, flash_string_vector{F_(set), F_(sensors), F_(verbose), F_(on)},
+			[] (Shell &shell, const std::vector<std::string> &arguments __attribute__((unused))) {
+		set_sensors_verbose(shell, true);
+	});
+
+	commands->add_command(ShellContext::MAIN, CommandFlags::ADMIN, flash_string_vector{F_(set), F_(sensors), F_(verbose), F_(off)},
+			[] (Shell &shell, const std::vector<std::string> &arguments __attribute__((unused))) {
+		set_sensors_verbose(shell, false);
+	});
+
+	commands->add_command(ShellContext::MAIN, CommandFlags::ADMIN, flash_string_vector{F_(set), F_(sensors), F_(short_read), F_(on)},
+			[] (Shell &shell, const std::vector<std::string> &arguments __attribute__((unused))) {
+		set_sensors_short_read(shell, true);
+	});
+
+	commands->add_command(ShellContext::MAIN, CommandFlags::ADMIN, flash_string_vector{F_(set), F_(sensors), F_(short_read), F_(off)},
+			[] (Shell &shell, const std::vector<std::string> &arguments __attribute__((unused))) {
+		set_sensors_short_read(shell, false);
+	});
+
+	commands->add_command(ShellContext::MAIN, CommandFlags::ADMIN, flash_string_vector{F_(set), F_(compressor), F_(power)}, flash_string_vector{F_(watts_mandatory)},
+			[] (Shell &shell, const std::vector<std::string> &arguments) {
+		Config config;
+		config.compressor_power(String(arguments.front().c_str()).toFloat());
+		config.commit();
+
+		shell.printfln(F_(compressor_power_fmt), config.compressor_power());
+	});
+
+	commands->add_command(ShellContext::MAIN, CommandFlags::ADMIN, flash_string_vector{F_(set), F_(watchdog), F_(timeout)}, flash_string_vector{F_(milliseconds_mandatory)},
+			[] (Shell &shell, const std::vector<std::string> &arguments) {
+		Config config;
+		config.watchdog_timeout(String(arguments.front().c_str()).toInt());
+		config.commit();
+		to_app(shell).configure_watchdog();
+
+		shell.printfln(F_(watchdog_timeout_fmt), config.watchdog_timeout());
+	});
+
+	commands->add_command(ShellContext::MAIN, CommandFlags::ADMIN, flash_string_vector{F_(set), F_(alarm), F_(high)}, flash_string_vector{F_(celsius_mandatory)},
+			[] (Shell &shell, const std::vector<std::string> &arguments) {
+		Config config;
+		float temperature = String(arguments.front().c_str()).toFloat();
+
+		if (temperature <= config.alarm_low_temperature()) {
+			shell.printfln(F("High temperature alarm must be above the low temperature alarm"));
+		} else {
+			config.alarm_high_temperature(temperature);
+			config.commit();
+		}
+
+		shell.printfln(F_(alarm_high_fmt), config.alarm_high_temperature());
+	});
+
+	commands->add_command(ShellContext::MAIN, CommandFlags::ADMIN, flash_string_vector{F_(set), F_(alarm), F_(low)}, flash_string_vector{F_(celsius_mandatory)},
+			[] (Shell &shell, const std::vector<std::string> &arguments) {
+		Config config;
+		float temperature = String(arguments.front().c_str()).toFloat();
+
+		if (temperature >= config.alarm_high_temperature()) {
+			shell.printfln(F("Low temperature alarm must be below the high temperature alarm"));
+		} else {
+			config.alarm_low_temperature(temperature);
+			config.commit();
+		}
+
+		shell.printfln(F_(alarm_low_fmt), config.alarm_low_temperature());
+	});
+
+	commands->add_command(ShellContext::MAIN, CommandFlags::ADMIN, flash_string_vector{F_(set), F_(alarm), F_(hysteresis)}, flash_string_vector{F_(celsius_mandatory)},
+			[] (Shell &shell, const std::vector<std::string> &arguments) {
+		Config config;
+		config.alarm_hysteresis(String(arguments.front().c_str()).toFloat());
+		config.commit();
+
+		shell.printfln(F_(alarm_hysteresis_fmt), config.alarm_hysteresis());
+	});
+
+	commands->add_command(ShellContext::MAIN, CommandFlags::ADMIN, flash_string_vector{F_(set), F_(alarm), F_(delay)}, flash_string_vector{F_(seconds_mandatory)},
+			[] (Shell &shell, const std::vector<std::string> &arguments) {
+		Config config;
+		config.alarm_delay(String(arguments.front().c_str()).toInt());
+		config.commit();
+
+		shell.printfln(F_(alarm_delay_fmt), config.alarm_delay());
+	});
+
+	/*
+	 * The events are read directly from RTC memory and formatted on the stack
+	 * so that the log can be shown even when the heap is fragmented.
+	 */
+	commands->add_command(ShellContext::MAIN, CommandFlags::USER, flash_string_vector{F_(show), F_(alarms)},
+			[] (Shell &shell, const std::vector<std::string> &arguments __attribute__((unused))) {
+		auto &alarms = to_app(shell).alarms();
+		std::array<char, 20> time_str;
+		std::array<char, 24> sensor_str;
+		std::array<char, 16> temperature_str;
+		Config config;
+
+		shell.printfln(F_(alarm_high_fmt), config.alarm_high_temperature());
+		shell.printfln(F_(alarm_low_fmt), config.alarm_low_temperature());
+		shell.printfln(F_(alarm_hysteresis_fmt), config.alarm_hysteresis());
+		shell.printfln(F_(alarm_delay_fmt), config.alarm_delay());
+		shell.printfln(F("Active alarms: %u (%S)"), alarms.active(),
+			alarms.buzzer() ? F("unacknowledged") : F("acknowledged"));
+		shell.println();
+		shell.printfln(F("Boot Time                Uptime        Sensor                  Temp Event"));
+
+		for (uint32_t sequence = alarms.first_sequence(); sequence != alarms.next_sequence(); sequence++) {
+			const Alarms::Event *event = alarms.event(sequence);
+
+			if (!event) {
+				continue;
+			}
+
+			if (event->time != 0) {
+				time_t time = event->time;
+				struct tm tm;
+
+				gmtime_r(&time, &tm);
+				strftime(time_str.data(), time_str.size(), "%Y-%m-%d %H:%M:%S", &tm);
+			} else {
+				::snprintf_P(time_str.data(), time_str.size(), PSTR("-"));
+			}
+
+			if (event->id != 0) {
+				Sensors::Device(event->id).to_string(sensor_str.data(), sensor_str.size());
+			} else {
+				::snprintf_P(sensor_str.data(), sensor_str.size(), PSTR("-"));
+			}
+
+			if (event->temperature_cc != std::numeric_limits<int16_t>::min()) {
+				::snprintf_P(temperature_str.data(), temperature_str.size(), PSTR("%.2f"), event->temperature_cc / 100.0f);
+			} else {
+				::snprintf_P(temperature_str.data(), temperature_str.size(), PSTR("-"));
+			}
+
+			shell.printfln(F("%4lu %-19s %03lu+%02lu:%02lu:%02lu %-20s %7s %S"),
+				(unsigned long)event->boot, time_str.data(),
+				(unsigned long)(event->uptime_s / 86400),
+				(unsigned long)(event->uptime_s / 3600 % 24),
+				(unsigned long)(event->uptime_s / 60 % 60),
+				(unsigned long)(event->uptime_s % 60),
+				sensor_str.data(), temperature_str.data(),
+				Alarms::type_name(event->type));
+		}
+	});
+
+	commands->add_command(ShellContext::MAIN, CommandFlags::ADMIN, flash_string_vector{F_(set), F_(multicast), F_(on)},
+			[] (Shell &shell, const std::vector<std::string> &arguments __attribute__((unused))) {
+		set_multicast(shell, true);
+	});
+
+	commands->add_command(ShellContext::MAIN, CommandFlags::ADMIN, flash_string_vector{F_(set), F_(multicast), F_(off)},
+			[] (Shell &shell, const std::vector<std::string> &arguments __attribute__((unused))) {
+		set_multicast(shell, false);
+	});
+
+	commands->add_command(ShellContext::MAIN, CommandFlags::USER, flash_string_vector{F_(show), F_(fridges)},
+			[] (Shell &shell, const std::vector<std::string> &arguments __attribute__((unused))) {
+		auto &multicast = to_app(shell).multicast();
+		IPAddress group = Multicast::group();
+
+		shell.printfln(F_(multicast_status_fmt), multicast.enabled() ? F_(on) : F_(off));
+		shell.printfln(F("Group %u.%u.%u.%u port %u: %S, %lu sent, %lu received, %lu invalid"),
+			group[0], group[1], group[2], group[3], Multicast::PORT,
+			multicast.active() ? F("joined") : F("not joined"),
+			multicast.sent(), multicast.received(), multicast.invalid());
+
+		if (!multicast.active()) {
+			return;
+		}
+
+		shell.println();
+		shell.printfln(F("Hostname         Address            Age Relay Door   Alarm  Lost Temperatures"));
+
+		if (multicast.self().address != 0) {
+			show_fridge(shell, multicast.self());
+		}
+
+		for (auto &peer : multicast.peers()) {
+			if (peer.address != 0) {
+				show_fridge(shell, peer);
+			}
+		}
+	});
+
+	commands->add_command(ShellContext::MAIN, CommandFlags::USER, flash_string_vector{F_(show), F_(memory)},
+			[] (Shell &shell, const std::vector<std::string> &arguments __attribute__((unused))) {
+		shell.printfln(F("Heap: %u bytes free of %u (minimum %u), largest free block %u bytes"),
+			ESP.getFreeHeap(), ESP.getHeapSize(), ESP.getMinFreeHeap(), ESP.getMaxAllocHeap());
+		shell.println();
+		shell.printfln(F("Subsystem   Current     Peak  Allocs/min   Allocs    Frees"));
+
+		for (size_t i = 0; i < Memory::SUBSYSTEMS; i++) {
+			auto subsystem = static_cast<Memory::Subsystem>(i);
+			auto &usage = Memory::usage(subsystem);
+
+			shell.printfln(F("%-9S %9zu %8zu %11lu %8lu %8lu"), Memory::subsystem_name(subsystem),
+				usage.current_, usage.peak_, usage.rate_per_min_, usage.allocations_, usage.frees_);
+		}
+
+		shell.println();
+		shell.println(F("Console usage is the application's state for each session and any history export"));
+		shell.println(F("in progress, excluding the console library's part of each session and its buffers."));
+	});
+
 	commands->add_command(ShellContext::MAIN, CommandFlags::USER, flash_string_vector{F_(show), F_(relay)},
-			[] (Shell &shell __attribute__((unused)), const std::vector<std::string> &arguments __attribute__((unused))) {
+			[] (Shell &shell, const std::vector<std::string> &arguments __attribute__((unused))) {
+		auto &compressor = to_app(shell).compressor();
+		auto &controller = to_app(shell).controller();
+		uint64_t now_ms = uuid::get_uptime_ms();
+		Config config;
+
+		if (to_app(shell).relay_auto()) {
+			shell.printfln(F_(control_mode_fmt), config.predictive_control() ? F_(predictive) : F_(hysteresis));
+		} else {
+			shell.printfln(F_(control_mode_fmt), F("manual"));
+		}
+
+		if (compressor.last_change_ms() != 0) {
+			shell.printfln(F("Relay: %S for %s"), compressor.running() ? F_(on) : F_(off),
+				uuid::log::format_timestamp_ms(now_ms - compressor.last_change_ms()).c_str());
+		} else {
+			shell.printfln(F("Relay: %S"), compressor.running() ? F_(on) : F_(off));
+		}
+
+		if (compressor.last_run_ms() != 0) {
+			shell.printfln(F("Last run: %s"), uuid::log::format_timestamp_ms(compressor.last_run_ms()).c_str());
+		}
+		if (compressor.last_rest_ms() != 0) {
+			shell.printfln(F("Last rest: %s"), uuid::log::format_timestamp_ms(compressor.last_rest_ms()).c_str());
+		}
 
+		shell.printfln(F("Cycles: %lu"), compressor.cycles());
+		shell.printfln(F("Runtime: %s"), uuid::log::format_timestamp_ms(compressor.runtime_ms()).c_str());
+
+		for (unsigned int i = 0; i < Compressor::WINDOWS; i++) {
+			shell.printfln(F("Duty cycle (%uh): %.1f%%"), Compressor::WINDOW_MINUTES[i] / 60, compressor.duty_cycle(i) * 100);
+		}
+
+		shell.printfln(F("Energy: %.3fkWh"), compressor.energy_kwh());
+		shell.printfln(F("Warming: %.2fC/h (lag %lus)"), controller.warming_rate_c_per_h(), controller.warming_lag_ms() / 1000);
+		shell.printfln(F("Cooling: %.2fC/h (lag %lus)"), controller.cooling_rate_c_per_h(), controller.cooling_lag_ms() / 1000);
 	});
 
 	commands->add_command(ShellContext::MAIN, CommandFlags::USER, flash_string_vector{F_(show), F_(sensors)},
-			[] (Shell &shell __attribute__((unused)), const std::vector<std::string> &arguments __attribute__((unused))) {
+			[] (Shell &shell, const std::vector<std::string> &arguments __attribute__((unused))) {
+		auto &sensors = to_app(shell).sensors();
+
+		shell.printfln(F("Power supply: %S, conversion time %lums"),
+			sensors.parasite() ? F("parasite") : F("external"), sensors.conversion_time_ms());
+		shell.printfln(F_(sensors_short_read_fmt), sensors.short_read() ? F_(on) : F_(off));
+		shell.printfln(F("Read time per device: %luus full, %luus short (%lu implausible)"),
+			sensors.full_read_us(), sensors.short_read_us(), sensors.implausible_reads());
 		for (auto& device : to_app(shell).sensor_devices()) {
 			shell.printfln(F("Sensor %s: %.2fC"), device.to_string().c_str(), device.temperature_c_);
 		}
 	});
 
+	commands->add_command(ShellContext::MAIN, CommandFlags::USER, flash_string_vector{F_(show), F_(watchdog)},
+			[] (Shell &shell, const std::vector<std::string> &arguments __attribute__((unused))) {
+		const Watchdog::Record *record = to_app(shell).watchdog().previous();
+		Config config;
+
+		shell.printfln(F_(watchdog_timeout_fmt), config.watchdog_timeout());
+
+		if (record) {
+			shell.printfln(F("Last stall: %S (%S) for %lums at uptime %s"),
+				Watchdog::subsystem_name(record->subsystem), Watchdog::detail_name(*record),
+				(unsigned long)record->stall_ms,
+				uuid::log::format_timestamp_ms(record->uptime_ms).c_str());
+		} else {
+			shell.println(F("Last stall: none"));
+		}
+	});
+
+	commands->add_command(ShellContext::MAIN, CommandFlags::USER, flash_string_vector{F_(show), F_(trace)},
+			[] (Shell &shell, const std::vector<std::string> &arguments __attribute__((unused))) {
+		static constexpr size_t BYTES_PER_LINE = 32;
+		auto &trace = to_app(shell).sensor_trace();
+		std::array<uint8_t, BYTES_PER_LINE> data;
+		std::array<char, BYTES_PER_LINE * 2 + 1> line;
+		size_t offset = 0;
+		size_t len;
+
+		shell.printfln(F("Trace: %zu bytes, %lu records dropped"), trace.used(), trace.dropped());
+
+		while ((len = trace.read(offset, data.data(), data.size())) > 0) {
+			for (size_t i = 0; i < len; i++) {
+				::snprintf_P(&line[i * 2], 3, PSTR("%02X"), data[i]);
+			}
+			line[len * 2] = '\0';
+
+			shell.println(line.data());
+			offset += len;
+		}
+	});
+
+	commands->add_command(ShellContext::MAIN, CommandFlags::ADMIN, flash_string_vector{F_(trace), F_(on)},
+			[] (Shell &shell, const std::vector<std::string> &arguments __attribute__((unused))) {
+		to_app(shell).sensor_trace(true);
+	});
+
+	commands->add_command(ShellContext::MAIN, CommandFlags::ADMIN, flash_string_vector{F_(trace), F_(off)},
+			[] (Shell &shell, const std::vector<std::string> &arguments __attribute__((unused))) {
+		to_app(shell).sensor_trace(false);
+	});
+
+	commands->add_command(ShellContext::MAIN, CommandFlags::USER, flash_string_vector{F_(export), F_(history)},
+			[] (Shell &shell, const std::vector<std::string> &arguments __attribute__((unused))) {
+		to_shell(shell).export_history();
+	});
+
+	commands->add_command(ShellContext::MAIN, CommandFlags::USER, flash_string_vector{F_(watch), F_(sensors)}, flash_string_vector{F_(milliseconds_optional)},
+			[] (Shell &shell, const std::vector<std::string> &arguments) {
+		unsigned long interval_ms = FridgeShell::WATCH_DEFAULT_INTERVAL_MS;
+
+		if (!arguments.empty()) {
+			interval_ms = String(arguments.front().c_str()).toInt();
+		}
+
+		to_shell(shell).watch_sensors(interval_ms);
+	});
+
 	commands->add_command(ShellContext::MAIN, CommandFlags::USER, flash_string_vector{F_(sensor)}, flash_string_vector{F_(id_mandatory)},
 			[] (Shell &shell, const std::vector<std::string> &arguments) {
 		to_shell(shell).enter_sensor_context(arguments.front());
 	},
-	[] (Shell &shell __attribute__((unused)), const std::vector<std::string> &arguments __attribute__((unused))) -> const std::vector<std::string> {
+	[] (Shell &shell, const std::vector<std::string> &arguments __attribute__((unused))) -> const std::vector<std::string> {
 		std::vector<std::string> devices;
 
 		for (auto& device : to_app(shell).sensor_devices()) {
@@ -204,8 +690,19 @@ static inline void setup_commands(std::shared_ptr<Commands> &commands) {
 	});
 }
 
+/*
+ * The session is constructed by the application framework as a type that
+ * derives from this one, so only the size of the application's part of it
+ * is known here. The rest of the session object, the stream or connection
+ * and the line editing and command history buffers belong to the framework
+ * and uuid::console and aren't included.
+ */
 FridgeShell::FridgeShell(app::App &app) : Shell(), AppShell(app) {
+	Memory::allocated(Memory::Subsystem::CONSOLE, sizeof(*this));
+}
 
+FridgeShell::~FridgeShell() {
+	Memory::freed(Memory::Subsystem::CONSOLE, sizeof(*this));
 }
 
 void FridgeShell::enter_sensor_context(std::string sensor) {
@@ -222,6 +719,81 @@ bool FridgeShell::exit_context() {
 	return AppShell::exit_context();
 }
 
+void FridgeShell::watch_sensors(unsigned long interval_ms) {
+	watch_interval_ms_ = std::max(interval_ms, WATCH_MINIMUM_INTERVAL_MS);
+	watch_generation_ = 0;
+	watch_last_ms_ = millis() - watch_interval_ms_;
+
+	block_with([this] (Shell &shell __attribute__((unused)), bool stop) -> bool {
+		return watch_sensors_loop(stop);
+	});
+}
+
+/*
+ * Only the devices that have changed since the last output are printed, so
+ * an idle session costs a comparison of the scan generation on each loop.
+ */
+bool FridgeShell::watch_sensors_loop(bool stop) {
+	if (stop) {
+		return true;
+	}
+
+	auto &app = static_cast<App&>(app_);
+	unsigned long generation = app.sensor_generation();
+
+	if (generation == watch_generation_
+			|| millis() - watch_last_ms_ < watch_interval_ms_) {
+		return false;
+	}
+
+	for (auto& device : app.sensor_devices()) {
+		if ((long)(device.changed_ - watch_generation_) > 0) {
+			size_t len = device.to_string(watch_line_.data(), watch_line_.size());
+
+			::snprintf_P(&watch_line_[len], watch_line_.size() - len,
+				__pstr__sensor_temperature_fmt, device.temperature_c_);
+			print(F("Sensor "));
+			println(watch_line_.data());
+		}
+	}
+
+	watch_generation_ = generation;
+	watch_last_ms_ = millis();
+	return false;
+}
+
+void FridgeShell::export_history() {
+	history_export_ = std::allocate_shared<HistoryExport>(MemoryAllocator<HistoryExport, Memory::Subsystem::CONSOLE>{});
+	history_export_->begin(static_cast<App&>(app_).history());
+	println(F("-----BEGIN FRIDGE HISTORY-----"));
+
+	block_with([this] (Shell &shell __attribute__((unused)), bool stop) -> bool {
+		return export_history_loop(stop);
+	});
+}
+
+/*
+ * One frame is output on each loop pass so that the rest of the application
+ * keeps running and the shell's output buffer isn't filled all at once.
+ */
+bool FridgeShell::export_history_loop(bool stop) {
+	if (stop) {
+		history_export_.reset();
+		return true;
+	}
+
+	const char *line = history_export_->next(static_cast<App&>(app_).history());
+
+	if (line) {
+		println(line);
+		return false;
+	} else {
+		println(F("-----END FRIDGE HISTORY-----"));
+		history_export_.reset();
+		return true;
+	}
+}
+
 void FridgeShell::display_banner() {
 	AppShell::display_banner();
 	println(F("┌─────────────────────────────────────────────────────────────────────────┐"));
@@ -249,7 +821,12 @@ std::string FridgeShell::context_text() {
 namespace app {
 
 void setup_commands(std::shared_ptr<Commands> &commands) {
+	uint32_t free_heap = ESP.getFreeHeap();
+
 	fridge::setup_commands(commands);
+
+	/* The command tree is allocated by the library, so only the total is known */
+	fridge::Memory::allocated(fridge::Memory::Subsystem::COMMANDS, free_heap - std::min(free_heap, ESP.getFreeHeap()));
 }
 
 } // namespace app
@@ -0,0 +1,226 @@
+/*
+ * fridge - Fridge Controller
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fridge/controller.h"
+
+#include <Arduino.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include <uuid/log.h>
+
+static const char __pstr__logger_name[] __attribute__((__aligned__(sizeof(int)))) PROGMEM = "controller";
+
+namespace fridge {
+
+uuid::log::Logger Controller::logger_{FPSTR(__pstr__logger_name), uuid::log::Facility::DAEMON};
+
+bool Controller::update(uint64_t now_ms, float temperature_c, bool running,
+		float minimum_c, float maximum_c, bool predictive) {
+	if (std::isnan(temperature_c)) {
+		return running;
+	}
+
+	if (!started_ || running != phase_.running_) {
+		switched(now_ms, temperature_c, running);
+	} else {
+		phase_.add(now_ms, temperature_c);
+	}
+	switch_target_c_ = NAN;
+
+	uint64_t elapsed_ms = now_ms - phase_.start_ms_;
+	bool fitted = phase_.samples() >= MINIMUM_FIT_SAMPLES;
+	float slope_c_per_s = phase_.slope_c_per_s();
+
+	if (running) {
+		if (elapsed_ms < MINIMUM_RUN_MS) {
+			return true;
+		} else if (temperature_c <= minimum_c) {
+			return false;
+		} else if (predictive && fitted && !std::isnan(cooling_lag_ms_) && slope_c_per_s < 0) {
+			if (temperature_c + slope_c_per_s * cooling_lag_ms_ / 1000 <= minimum_c + cooling_trim_c_) {
+				switch_target_c_ = minimum_c;
+				return false;
+			}
+		}
+		return true;
+	} else {
+		if (elapsed_ms < MINIMUM_REST_MS) {
+			return false;
+		} else if (temperature_c >= maximum_c) {
+			return true;
+		} else if (predictive && fitted && !std::isnan(warming_lag_ms_) && slope_c_per_s > 0) {
+			if (temperature_c + slope_c_per_s * warming_lag_ms_ / 1000 >= maximum_c - warming_trim_c_) {
+				switch_target_c_ = maximum_c;
+				return true;
+			}
+		}
+		return false;
+	}
+}
+
+/*
+ * Without a temperature the compressor is stopped once it has run for the
+ * minimum time. The phase in progress is abandoned so that nothing is
+ * learnt from it when control resumes.
+ */
+bool Controller::fail_safe(uint64_t now_ms, bool running, uint64_t last_change_ms) {
+	started_ = false;
+	switch_slope_c_per_s_ = NAN;
+	switch_target_c_ = NAN;
+
+	return running && now_ms - last_change_ms < MINIMUM_RUN_MS;
+}
+
+void Controller::switched(uint64_t now_ms, float temperature_c, bool running) {
+	if (started_) {
+		float slope_c_per_s = NAN;
+
+		if (phase_.samples() >= MINIMUM_FIT_SAMPLES) {
+			slope_c_per_s = phase_.slope_c_per_s();
+
+			if (phase_.running_) {
+				cooling_rate_c_per_s_ = learn(cooling_rate_c_per_s_, slope_c_per_s);
+			} else {
+				warming_rate_c_per_s_ = learn(warming_rate_c_per_s_, slope_c_per_s);
+			}
+		}
+
+		/*
+		 * The overshoot of the phase that has ended is expressed as the time
+		 * it would take at the rate of change before it started, so that it
+		 * scales with the current rate of change.
+		 */
+		if (!std::isnan(switch_slope_c_per_s_) && switch_slope_c_per_s_ != 0) {
+			float lag_ms = (phase_.extreme_c_ - switch_c_) / switch_slope_c_per_s_ * 1000;
+
+			if (lag_ms >= 0) {
+				if (phase_.running_) {
+					warming_lag_ms_ = learn(warming_lag_ms_, lag_ms);
+				} else {
+					cooling_lag_ms_ = learn(cooling_lag_ms_, lag_ms);
+				}
+			}
+		}
+
+		/*
+		 * The lag doesn't account for everything (e.g. the temperature only
+		 * being sampled periodically), so any remaining error in the extreme
+		 * that followed a predicted switch is corrected by moving the point
+		 * at which the next prediction switches.
+		 */
+		if (!std::isnan(phase_.target_c_)) {
+			if (phase_.running_) {
+				warming_trim_c_ = limit_trim(warming_trim_c_ + LEARNING_RATE * (phase_.extreme_c_ - phase_.target_c_));
+			} else {
+				cooling_trim_c_ = limit_trim(cooling_trim_c_ + LEARNING_RATE * (phase_.target_c_ - phase_.extreme_c_));
+			}
+		}
+
+		logger_.debug(F("Warming %.2fC/h (lag %.0fs, trim %.2fC), cooling %.2fC/h (lag %.0fs, trim %.2fC)"),
+			warming_rate_c_per_h(), warming_lag_ms_ / 1000, warming_trim_c_,
+			cooling_rate_c_per_h(), cooling_lag_ms_ / 1000, cooling_trim_c_);
+
+		switch_slope_c_per_s_ = slope_c_per_s;
+	}
+
+	switch_c_ = temperature_c;
+	started_ = true;
+	phase_.reset(now_ms, temperature_c, running, switch_target_c_);
+}
+
+float Controller::learn(float previous, float value) {
+	if (std::isnan(previous)) {
+		return value;
+	} else {
+		return previous + LEARNING_RATE * (value - previous);
+	}
+}
+
+float Controller::limit_trim(float trim_c) {
+	return std::max(-MAXIMUM_TRIM_C, std::min(MAXIMUM_TRIM_C, trim_c));
+}
+
+float Controller::warming_rate_c_per_h() const {
+	return warming_rate_c_per_s_ * 3600;
+}
+
+float Controller::cooling_rate_c_per_h() const {
+	return cooling_rate_c_per_s_ * 3600;
+}
+
+unsigned long Controller::warming_lag_ms() const {
+	return std::isnan(warming_lag_ms_) ? 0 : warming_lag_ms_;
+}
+
+unsigned long Controller::cooling_lag_ms() const {
+	return std::isnan(cooling_lag_ms_) ? 0 : cooling_lag_ms_;
+}
+
+void Controller::Phase::reset(uint64_t now_ms, float temperature_c, bool running, float target_c) {
+	running_ = running;
+	start_ms_ = now_ms;
+	target_c_ = target_c;
+	extreme_c_ = NAN;
+	add(now_ms, temperature_c);
+}
+
+/*
+ * The temperature continues in the same direction for a while after the
+ * compressor is switched, so the fit restarts from each new extreme.
+ */
+void Controller::Phase::add(uint64_t now_ms, float temperature_c) {
+	if (std::isnan(extreme_c_)
+			|| (running_ && temperature_c > extreme_c_)
+			|| (!running_ && temperature_c < extreme_c_)) {
+		extreme_c_ = temperature_c;
+		extreme_ms_ = now_ms;
+
+		n_ = 0;
+		sum_x_ = 0;
+		sum_y_ = 0;
+		sum_xx_ = 0;
+		sum_xy_ = 0;
+	}
+
+	double x = (now_ms - extreme_ms_) / 1000.0;
+	double y = temperature_c - extreme_c_;
+
+	n_++;
+	sum_x_ += x;
+	sum_y_ += y;
+	sum_xx_ += x * x;
+	sum_xy_ += x * y;
+}
+
+unsigned long Controller::Phase::samples() const {
+	return n_;
+}
+
+float Controller::Phase::slope_c_per_s() const {
+	double denominator = n_ * sum_xx_ - sum_x_ * sum_x_;
+
+	if (n_ < 2 || denominator == 0) {
+		return NAN;
+	}
+
+	return (n_ * sum_xy_ - sum_x_ * sum_y_) / denominator;
+}
+
+} // namespace fridge
@@ -33,6 +33,7 @@ uuid::log::Logger Door::logger_{FPSTR(__pstr__logger_name), uuid::log::Facility:
 void Door::start(int pin) {
 	pin_ = pin;
 	pinMode(pin_, INPUT_PULLUP);
+	last_activity_ = millis();
 }
 
 void Door::loop() {
@@ -56,4 +57,8 @@ void Door::loop() {
 	}
 }
 
+bool Door::open() const {
+	return stable_state_ == State::OPEN;
+}
+
 } // namespace fridge
@@ -0,0 +1,132 @@
+/*
+ * fridge - Fridge Controller
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include <array>
+
+#include <uuid/log.h>
+
+#include "sensors.h"
+
+namespace fridge {
+
+/**
+ * High and low temperature alarms for each sensor.
+ *
+ * An alarm is raised when a sensor has been beyond the threshold for the
+ * configured delay and cleared when it returns past the threshold by the
+ * hysteresis. A separate alarm is raised when there have been no valid
+ * readings from any sensor for several sample intervals. The buzzer stays
+ * on from the time an alarm is raised until it is acknowledged, even if
+ * the alarm clears before then.
+ *
+ * Events are kept in RTC memory so that they survive a restart.
+ */
+class Alarms {
+public:
+	static constexpr size_t LOG_SIZE = 32;
+
+	enum class Type : uint8_t {
+		HIGH_RAISED,
+		HIGH_CLEARED,
+		LOW_RAISED,
+		LOW_CLEARED,
+		SENSOR_LOST,
+		ACKNOWLEDGED,
+		NO_READINGS_RAISED,
+		NO_READINGS_CLEARED,
+	};
+
+	struct Event {
+		uint32_t sequence; /*!< Zero if unused */
+		uint32_t boot;
+		uint32_t time; /*!< Seconds since the epoch, zero if unknown */
+		uint32_t uptime_s;
+		uint64_t id;
+		int16_t temperature_cc; /*!< Hundredths of a degree */
+		Type type;
+		uint32_t checksum;
+	};
+
+	Alarms() = default;
+	~Alarms() = default;
+
+	static const __FlashStringHelper *type_name(Type type);
+
+	void start();
+	void loop();
+	void update(const Sensors::Devices &devices);
+	void acknowledge();
+
+	bool buzzer() const;
+	unsigned int active() const;
+	bool no_readings() const;
+
+	uint32_t boot() const;
+	uint32_t first_sequence() const;
+	uint32_t next_sequence() const;
+	const Event *event(uint32_t sequence) const;
+
+private:
+	static constexpr uint32_t MAGIC = 0x414C524D;
+	static constexpr size_t MAX_SENSORS = 16;
+	static constexpr time_t MINIMUM_TIME = 1640995200; /* 2022-01-01 */
+	static constexpr unsigned long NO_READINGS_TIMEOUT_MS = 2 * 60 * 1000;
+	static constexpr unsigned long NO_READINGS_INTERVALS = 3;
+
+	struct Log {
+		uint32_t magic;
+		uint32_t boots;
+		Event events[LOG_SIZE];
+	};
+
+	struct Sensor {
+		uint64_t id = 0; /*!< Zero if unused */
+		unsigned long high_since_ms = 0;
+		unsigned long low_since_ms = 0;
+		bool high_pending = false;
+		bool low_pending = false;
+		bool high = false;
+		bool low = false;
+		bool seen = false;
+	};
+
+	static uuid::log::Logger logger_;
+	static Log rtc_log_;
+
+	static uint32_t checksum(const Event &event);
+
+	Sensor *find(uint64_t id);
+	void evaluate(Sensor &sensor, const Sensors::Device &device,
+		unsigned long now_ms, float high_c, float low_c,
+		float hysteresis_c, unsigned long delay_ms);
+	void append(Type type, uint64_t id, float temperature_c);
+	void configure_readings_timeout();
+
+	std::array<Sensor,MAX_SENSORS> sensors_{};
+	bool unacknowledged_ = false;
+	bool no_readings_ = false;
+	unsigned long last_reading_ms_ = 0;
+	unsigned long readings_timeout_ms_ = NO_READINGS_TIMEOUT_MS;
+	uint32_t next_sequence_ = 1;
+};
+
+} // namespace fridge
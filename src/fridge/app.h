@@ -30,8 +30,14 @@
 #include "../app/app.h"
 #include "../app/console.h"
 #include "../app/network.h"
+#include "alarms.h"
+#include "compressor.h"
+#include "controller.h"
 #include "sensors.h"
 #include "door.h"
+#include "history.h"
+#include "multicast.h"
+#include "watchdog.h"
 
 namespace fridge {
 
@@ -51,13 +57,48 @@ public:
 	void loop() override;
 
 	void relay(bool value);
+	void relay_auto(bool value);
+	bool relay_auto() const;
 	void buzzer(bool value);
 
-	const std::vector<Sensors::Device> sensor_devices();
+	const Alarms &alarms() const;
+	const History &history() const;
+
+	void configure_multicast();
+	const Multicast &multicast() const;
+	void acknowledge_alarms();
+
+	const Compressor &compressor() const;
+	const Controller &controller() const;
+
+	void configure_watchdog();
+	const Watchdog &watchdog() const;
+
+	void configure_sensors();
+	void sensor_trace(bool enabled);
+	const BusTrace &sensor_trace() const;
+	const Sensors::Devices &sensor_devices() const;
+	const Sensors &sensors() const;
+	unsigned long sensor_generation() const;
 
 private:
+	void control();
+	void control_fail_safe();
+	void check_alarms();
+
+	Compressor compressor_;
+	Controller controller_;
+	bool relay_auto_ = true;
+	unsigned long control_generation_ = 0;
+	bool control_failed_ = false;
+	bool buzzer_ = false;
+	Alarms alarms_;
+	unsigned long alarms_generation_ = 0;
+	History history_;
+	Multicast multicast_;
 	Sensors sensors_;
 	Door door_;
+	Watchdog watchdog_;
 };
 
 } // namespace fridge
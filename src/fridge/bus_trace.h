@@ -0,0 +1,83 @@
+/*
+ * fridge - Fridge Controller
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include <vector>
+
+#include "memory.h"
+
+namespace fridge {
+
+/**
+ * Ring buffer of bus operations and their results.
+ *
+ * Each record is an operation, data length, start time (µs, 32-bit), duration
+ * (µs, 16-bit, saturated) and the data, with multi-byte values in little
+ * endian order. The oldest records are discarded to make space for new ones.
+ *
+ * Repeated reads while waiting for a conversion to complete are recorded as
+ * one poll operation when the wait ends, with the start time and duration
+ * of the final read.
+ */
+class BusTrace {
+public:
+	enum class Operation : uint8_t {
+		RESET = 1,      /*!< Data: presence */
+		SKIP = 2,
+		SELECT = 3,     /*!< Data: address */
+		WRITE = 4,      /*!< Data: value */
+		READ_BIT = 5,   /*!< Data: value */
+		READ_BYTES = 6, /*!< Data: values */
+		RESET_SEARCH = 7,
+		SEARCH = 8,     /*!< Data: result, address */
+		DEPOWER = 9,
+		CYCLE = 10,     /*!< Data: number of devices (16-bit) */
+		POLL = 11,      /*!< Data: reads (16-bit), final value, total read time (µs, 32-bit) */
+	};
+
+	static constexpr size_t HEADER_LEN = 8;
+	static constexpr size_t DEFAULT_SIZE = 4096;
+
+	BusTrace() = default;
+	~BusTrace() = default;
+
+	void enable(size_t size = DEFAULT_SIZE);
+	void disable();
+	inline bool enabled() const { return !buffer_.empty(); }
+
+	void record(Operation operation, unsigned long start_us, const uint8_t *data = nullptr, size_t len = 0);
+
+	size_t used() const;
+	size_t read(size_t offset, uint8_t *data, size_t len) const;
+	unsigned long dropped() const;
+
+private:
+	static constexpr size_t MAX_DATA_LEN = 255;
+
+	void put(uint8_t value);
+
+	std::vector<uint8_t, MemoryAllocator<uint8_t, Memory::Subsystem::TRACE>> buffer_;
+	size_t head_ = 0;
+	size_t used_ = 0;
+	unsigned long dropped_ = 0;
+};
+
+} // namespace fridge
@@ -0,0 +1,80 @@
+/*
+ * fridge - Fridge Controller
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include <array>
+
+#include <uuid/log.h>
+
+namespace fridge {
+
+class Compressor {
+public:
+	static constexpr unsigned int WINDOWS = 3;
+	static constexpr std::array<unsigned int,WINDOWS> WINDOW_MINUTES{60, 6 * 60, 24 * 60};
+
+	Compressor() = default;
+	~Compressor() = default;
+
+	void start();
+	void loop();
+
+	void running(bool value);
+	bool running() const;
+
+	uint64_t last_change_ms() const;
+	uint64_t last_run_ms() const;
+	uint64_t last_rest_ms() const;
+	unsigned long cycles() const;
+	uint64_t runtime_ms() const;
+	float duty_cycle(unsigned int window) const;
+	float energy_kwh() const;
+
+private:
+	static constexpr unsigned long BUCKET_MS = 5 * 60 * 1000;
+	static constexpr size_t BUCKETS = 24 * 60 * 60 * 1000 / BUCKET_MS;
+	static constexpr unsigned long SAVE_INTERVAL_MS = 60 * 60 * 1000;
+
+	static uuid::log::Logger logger_;
+
+	void accumulate(uint64_t now_ms);
+	void load();
+	void save();
+
+	bool running_ = false;
+	uint64_t last_change_ms_ = 0;
+	uint64_t last_run_ms_ = 0;
+	uint64_t last_rest_ms_ = 0;
+	unsigned long cycles_ = 0;
+	uint64_t runtime_ms_ = 0;
+	uint64_t accounted_ms_ = 0;
+	uint64_t energy_mj_ = 0; /*!< Millijoules (W x ms) */
+
+	std::array<uint16_t,BUCKETS> buckets_{}; /*!< Seconds running in each completed bucket */
+	size_t bucket_ = 0;
+	size_t buckets_filled_ = 0;
+	uint64_t bucket_start_ms_ = 0;
+	uint64_t bucket_running_ms_ = 0;
+
+	uint64_t last_save_ms_ = 0;
+};
+
+} // namespace fridge
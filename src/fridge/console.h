@@ -20,6 +20,10 @@
 
 #include "app/console.h"
 
+#include "history_export.h"
+#include "memory.h"
+
+#include <array>
 #include <memory>
 #include <string>
 #include <vector>
@@ -28,11 +32,16 @@ namespace fridge {
 
 class FridgeShell: public app::AppShell {
 public:
-	~FridgeShell() override = default;
+	~FridgeShell() override;
+
+	static constexpr unsigned long WATCH_DEFAULT_INTERVAL_MS = 1000;
 
 	void enter_sensor_context(std::string sensor);
 	bool exit_context() override;
 
+	void watch_sensors(unsigned long interval_ms);
+	void export_history();
+
 protected:
 	FridgeShell(app::App &app);
 
@@ -40,7 +49,18 @@ protected:
 	std::string context_text() override;
 
 private:
+	static constexpr unsigned long WATCH_MINIMUM_INTERVAL_MS = 100;
+	static constexpr size_t WATCH_LINE_LEN = 48;
+
+	bool watch_sensors_loop(bool stop);
+	bool export_history_loop(bool stop);
+
 	std::string sensor_;
+	unsigned long watch_interval_ms_ = WATCH_DEFAULT_INTERVAL_MS;
+	unsigned long watch_generation_ = 0;
+	unsigned long watch_last_ms_ = 0;
+	std::array<char, WATCH_LINE_LEN> watch_line_{};
+	std::shared_ptr<HistoryExport> history_export_; /*!< Only allocated during an export */
 };
 
 } // namespace fridge
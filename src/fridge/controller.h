@@ -0,0 +1,104 @@
+/*
+ * fridge - Fridge Controller
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include <uuid/log.h>
+
+namespace fridge {
+
+/**
+ * Decides when the compressor should run to keep the temperature within
+ * the configured range.
+ *
+ * In predictive mode the rate of change in the current phase is fitted
+ * incrementally and the delay between switching the compressor and the
+ * temperature turning around is learnt from each phase. The compressor is
+ * switched early enough that the temperature peaks/troughs at the limits
+ * instead of overshooting them, so the whole range is used for each cycle.
+ *
+ * This has no dependencies on the hardware so that it can be driven by a
+ * simulation.
+ */
+class Controller {
+public:
+	Controller() = default;
+	~Controller() = default;
+
+	bool update(uint64_t now_ms, float temperature_c, bool running,
+		float minimum_c, float maximum_c, bool predictive);
+	bool fail_safe(uint64_t now_ms, bool running, uint64_t last_change_ms);
+
+	float warming_rate_c_per_h() const;
+	float cooling_rate_c_per_h() const;
+	unsigned long warming_lag_ms() const;
+	unsigned long cooling_lag_ms() const;
+
+private:
+	class Phase {
+	public:
+		void reset(uint64_t now_ms, float temperature_c, bool running, float target_c);
+		void add(uint64_t now_ms, float temperature_c);
+		unsigned long samples() const;
+		float slope_c_per_s() const;
+
+		bool running_ = false;
+		uint64_t start_ms_ = 0;
+		float extreme_c_ = NAN;
+		uint64_t extreme_ms_ = 0;
+		float target_c_ = NAN; /*!< Limit that the extreme was predicted to reach */
+
+	private:
+		/* Least squares sums, relative to the last extreme */
+		unsigned long n_ = 0;
+		double sum_x_ = 0;
+		double sum_y_ = 0;
+		double sum_xx_ = 0;
+		double sum_xy_ = 0;
+	};
+
+	static constexpr unsigned long MINIMUM_RUN_MS = 2 * 60 * 1000;
+	static constexpr unsigned long MINIMUM_REST_MS = 5 * 60 * 1000;
+	static constexpr unsigned long MINIMUM_FIT_SAMPLES = 5;
+	static constexpr float LEARNING_RATE = 0.25f;
+	static constexpr float MAXIMUM_TRIM_C = 1.0f;
+
+	static uuid::log::Logger logger_;
+
+	static float learn(float previous, float value);
+	static float limit_trim(float trim_c);
+
+	void switched(uint64_t now_ms, float temperature_c, bool running);
+
+	bool started_ = false;
+	Phase phase_;
+	float switch_c_ = NAN;
+	float switch_slope_c_per_s_ = NAN;
+	float switch_target_c_ = NAN;
+
+	float warming_rate_c_per_s_ = NAN;
+	float cooling_rate_c_per_s_ = NAN;
+	float warming_lag_ms_ = NAN; /*!< Overshoot after starting the compressor, as time at the previous rate */
+	float cooling_lag_ms_ = NAN; /*!< Undershoot after stopping the compressor, as time at the previous rate */
+	float warming_trim_c_ = 0; /*!< Start this much earlier than predicted */
+	float cooling_trim_c_ = 0; /*!< Stop this much earlier than predicted */
+};
+
+} // namespace fridge
@@ -32,6 +32,8 @@ public:
 	void start(int pin);
 	void loop();
 
+	bool open() const;
+
 private:
 	enum class State {
 		UNKNOWN,
@@ -44,7 +46,7 @@ private:
 	static uuid::log::Logger logger_;
 
 	int pin_;
-	unsigned long last_activity_ = millis();
+	unsigned long last_activity_ = 0;
 	State stable_state_ = State::UNKNOWN;
 	State new_state_ = State::UNKNOWN;
 };
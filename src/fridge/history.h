@@ -0,0 +1,78 @@
+/*
+ * fridge - Fridge Controller
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include <array>
+#include <vector>
+
+#include <uuid/log.h>
+
+#include "memory.h"
+#include "sensors.h"
+
+namespace fridge {
+
+/**
+ * Ring buffer of temperature samples taken at a fixed interval.
+ *
+ * Samples are identified by a sequence number that increases for every
+ * sample recorded, so that a reader can detect samples that have been
+ * overwritten while it was reading.
+ */
+class History {
+public:
+	static constexpr unsigned long SAMPLE_INTERVAL_MS = 60 * 1000;
+	static constexpr size_t CAPACITY = 4 * 24 * 60;
+	static constexpr size_t MAX_DEVICES = 16;
+
+	struct __attribute__((packed)) Sample {
+		uint32_t uptime_s;
+		int16_t temperature; /*!< Sixteenths of a degree */
+		uint8_t device; /*!< Index in the device table */
+	};
+
+	History() = default;
+	~History() = default;
+
+	void start();
+	void loop(const Sensors::Devices &devices);
+
+	uint32_t first() const;
+	uint32_t next() const;
+	const Sample *sample(uint32_t sequence) const;
+
+	size_t device_count() const;
+	uint64_t device_id(size_t index) const;
+
+private:
+	static uuid::log::Logger logger_;
+
+	int device_index(uint64_t id);
+
+	std::vector<Sample, MemoryAllocator<Sample, Memory::Subsystem::HISTORY>> samples_;
+	uint32_t next_ = 0;
+	unsigned long last_sample_ms_ = 0;
+	std::array<uint64_t,MAX_DEVICES> devices_{};
+	size_t device_count_ = 0;
+	bool devices_full_ = false;
+};
+
+} // namespace fridge
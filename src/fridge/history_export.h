@@ -0,0 +1,96 @@
+/*
+ * fridge - Fridge Controller
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include <array>
+
+#include "history.h"
+
+namespace fridge {
+
+/**
+ * Encodes the history as a sequence of frames, one line of base64 text at
+ * a time, so that it can be streamed without buffering the whole export.
+ *
+ * Each frame is a type, payload length (16-bit), payload and CRC-16/CCITT
+ * of all the preceding bytes, with multi-byte values in little endian
+ * order. The export is a header frame with the time, sample interval and
+ * device addresses, then sample frames, then an end frame with the number
+ * of samples.
+ *
+ * Samples are a device index, time since the previous sample in the frame
+ * (seconds, unsigned varint) and temperature change since the previous
+ * sample for the device in the frame (sixteenths of a degree, zigzag
+ * varint). The first values in each frame are relative to zero so that
+ * every frame can be decoded independently.
+ */
+class HistoryExport {
+public:
+	static constexpr uint8_t VERSION = 1;
+
+	enum class Frame : uint8_t {
+		HEADER = 1,  /*!< Version, uptime (s, 32-bit), time (s, 32-bit, zero if unknown), sample interval (s, 16-bit), device count, addresses (64-bit) */
+		SAMPLES = 2, /*!< Samples */
+		END = 3,     /*!< Number of samples (32-bit), number of samples that were overwritten during the export (32-bit) */
+	};
+
+	HistoryExport() = default;
+	~HistoryExport() = default;
+
+	void begin(const History &history);
+	const char *next(const History &history);
+
+private:
+	static constexpr time_t MINIMUM_TIME = 1640995200; /* 2022-01-01 */
+	static constexpr size_t MAX_PAYLOAD_LEN = 240;
+	static constexpr size_t MAX_SAMPLE_LEN = 1 + 5 + 3;
+	static constexpr size_t FRAME_HEADER_LEN = 3;
+	static constexpr size_t FRAME_CRC_LEN = 2;
+	static constexpr size_t MAX_FRAME_LEN = FRAME_HEADER_LEN + MAX_PAYLOAD_LEN + FRAME_CRC_LEN;
+
+	enum class State : uint8_t {
+		HEADER,
+		SAMPLES,
+		END,
+		DONE,
+	};
+
+	static uint16_t crc16(const uint8_t *data, size_t len);
+
+	void start_frame(Frame type);
+	void put(uint8_t value);
+	void put16(uint16_t value);
+	void put32(uint32_t value);
+	void put64(uint64_t value);
+	void put_varint(uint32_t value);
+	const char *finish_frame();
+
+	std::array<uint8_t, MAX_FRAME_LEN> frame_{};
+	std::array<char, (MAX_FRAME_LEN + 2) / 3 * 4 + 1> line_{};
+	size_t len_ = 0;
+	State state_ = State::DONE;
+	uint32_t sequence_ = 0;
+	uint32_t end_ = 0;
+	uint32_t count_ = 0;
+	uint32_t lost_ = 0;
+};
+
+} // namespace fridge
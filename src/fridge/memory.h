@@ -0,0 +1,113 @@
+/*
+ * fridge - Fridge Controller
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include <array>
+#include <memory>
+
+namespace fridge {
+
+/**
+ * Heap usage by each subsystem, recorded by containers that use
+ * MemoryAllocator and by explicit calls for other allocations.
+ */
+class Memory {
+public:
+	enum class Subsystem : uint8_t {
+		SENSORS,
+		TRACE,
+		CONSOLE, /*!< Application state of each session and history exports */
+		COMMANDS,
+		HISTORY,
+		COUNT, /*!< Number of subsystems */
+	};
+
+	static constexpr size_t SUBSYSTEMS = static_cast<size_t>(Subsystem::COUNT);
+
+	class Usage {
+	public:
+		size_t current_ = 0;
+		size_t peak_ = 0;
+		unsigned long allocations_ = 0;
+		unsigned long frees_ = 0;
+		unsigned long rate_per_min_ = 0; /*!< Allocations in the last complete minute */
+
+	private:
+		friend class Memory;
+
+		unsigned long rate_allocations_ = 0;
+	};
+
+	static const __FlashStringHelper *subsystem_name(Subsystem subsystem);
+
+	static void loop();
+
+	static void allocated(Subsystem subsystem, size_t size);
+	static void freed(Subsystem subsystem, size_t size);
+	static const Usage &usage(Subsystem subsystem);
+
+private:
+	static constexpr unsigned long RATE_INTERVAL_MS = 60 * 1000;
+
+	Memory() = delete;
+
+	static std::array<Usage,SUBSYSTEMS> usage_;
+	static unsigned long rate_start_ms_;
+};
+
+template <typename T, Memory::Subsystem S>
+class MemoryAllocator {
+public:
+	using value_type = T;
+
+	template <typename U>
+	struct rebind {
+		using other = MemoryAllocator<U, S>;
+	};
+
+	MemoryAllocator() = default;
+
+	template <typename U>
+	MemoryAllocator(const MemoryAllocator<U, S> &other __attribute__((unused))) {}
+
+	T *allocate(size_t n) {
+		T *ptr = std::allocator<T>().allocate(n);
+		Memory::allocated(S, n * sizeof(T));
+		return ptr;
+	}
+
+	void deallocate(T *ptr, size_t n) {
+		Memory::freed(S, n * sizeof(T));
+		std::allocator<T>().deallocate(ptr, n);
+	}
+};
+
+template <typename T, typename U, Memory::Subsystem S>
+inline bool operator==(const MemoryAllocator<T, S>&, const MemoryAllocator<U, S>&) {
+	return true;
+}
+
+template <typename T, typename U, Memory::Subsystem S>
+inline bool operator!=(const MemoryAllocator<T, S>&, const MemoryAllocator<U, S>&) {
+	return false;
+}
+
+} // namespace fridge
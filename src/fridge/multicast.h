@@ -0,0 +1,119 @@
+/*
+ * fridge - Fridge Controller
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <WiFiUdp.h>
+
+#include <array>
+
+#include <uuid/log.h>
+
+#include "sensors.h"
+
+namespace fridge {
+
+/**
+ * Sends the status of this controller to a multicast group and keeps a
+ * table of the status of other controllers in the group.
+ *
+ * Frames are a fixed size with multi-byte values in little endian order:
+ * magic (32-bit), version, flags, sensor count, reserved, sequence number
+ * (32-bit), uptime (s, 32-bit), hostname (16 bytes, zero padded) and then
+ * for every sensor (including unused ones) the address (64-bit) and
+ * temperature (sixteenths of a degree, 16-bit signed, minimum if unknown).
+ */
+class Multicast {
+public:
+	static constexpr uint8_t FLAG_RELAY = 1U << 0;
+	static constexpr uint8_t FLAG_RELAY_AUTO = 1U << 1;
+	static constexpr uint8_t FLAG_DOOR_OPEN = 1U << 2;
+	static constexpr uint8_t FLAG_ALARM = 1U << 3;
+	static constexpr uint8_t FLAG_ALARM_UNACKNOWLEDGED = 1U << 4;
+
+	static constexpr uint16_t PORT = 37322;
+	static constexpr size_t MAX_SENSORS = 8;
+	static constexpr size_t MAX_PEERS = 8;
+	static constexpr size_t HOSTNAME_LEN = 16;
+	static constexpr int16_t UNKNOWN_TEMPERATURE = INT16_MIN;
+
+	struct Peer {
+		uint32_t address = 0; /*!< Zero if unused */
+		unsigned long last_seen_ms = 0;
+		uint32_t sequence = 0;
+		uint32_t uptime_s = 0;
+		unsigned long lost = 0; /*!< Frames missing from the sequence */
+		uint8_t flags = 0;
+		uint8_t sensor_count = 0;
+		char hostname[HOSTNAME_LEN + 1] = { 0 };
+		std::array<uint64_t,MAX_SENSORS> ids{};
+		std::array<int16_t,MAX_SENSORS> temperatures{};
+	};
+
+	Multicast() = default;
+	~Multicast() = default;
+
+	static IPAddress group();
+
+	void start();
+	void configure();
+	void loop(const Sensors::Devices &devices, uint8_t flags);
+
+	bool enabled() const;
+	bool active() const;
+	unsigned long sent() const;
+	unsigned long received() const;
+	unsigned long invalid() const;
+
+	const Peer &self() const;
+	const std::array<Peer,MAX_PEERS> &peers() const;
+
+private:
+	static constexpr uint32_t MAGIC = 0x47445246; /* "FRDG" */
+	static constexpr uint8_t VERSION = 1;
+	static constexpr size_t HEADER_LEN = 32;
+	static constexpr size_t SENSOR_LEN = 10;
+	static constexpr size_t FRAME_LEN = HEADER_LEN + MAX_SENSORS * SENSOR_LEN;
+	static constexpr unsigned long SEND_INTERVAL_MS = 10 * 1000;
+	static constexpr unsigned long PEER_TIMEOUT_MS = 6 * SEND_INTERVAL_MS;
+	static constexpr unsigned int MAX_RECEIVE_PER_LOOP = 4;
+
+	static uuid::log::Logger logger_;
+
+	void send(const Sensors::Devices &devices, uint8_t flags);
+	void receive();
+	void expire();
+	bool decode(Peer &peer) const;
+	Peer *find(uint32_t address, const char *hostname);
+
+	WiFiUDP udp_;
+	bool enabled_ = false;
+	bool active_ = false;
+	std::array<char,HOSTNAME_LEN + 1> hostname_{};
+	std::array<uint8_t,FRAME_LEN> frame_{};
+	uint32_t sequence_ = 0;
+	unsigned long last_send_ms_ = 0;
+	unsigned long sent_ = 0;
+	unsigned long received_ = 0;
+	unsigned long invalid_ = 0;
+	Peer self_;
+	std::array<Peer,MAX_PEERS> peers_{};
+};
+
+} // namespace fridge
@@ -20,12 +20,16 @@
 
 #include <Arduino.h>
 
+#include <array>
 #include <string>
 #include <vector>
 
 #include <uuid/log.h>
 #include <OneWire.h>
 
+#include "bus_trace.h"
+#include "memory.h"
+
 namespace fridge {
 
 class Sensors {
@@ -33,58 +37,176 @@ public:
 	class Device {
 	public:
 		Device(const uint8_t addr[]);
+		explicit Device(uint64_t id);
 		~Device() = default;
 
 		uint64_t id() const;
+		void address(uint8_t addr[]) const;
 		std::string to_string() const;
+		size_t to_string(char *str, size_t len) const;
 
 		float temperature_c_ = NAN;
+		unsigned long changed_ = 0; /*!< Scan generation of the last temperature change */
+		float slope_c_per_min_ = NAN;
+		float reference_c_ = NAN;
+		unsigned long reference_ms_ = 0;
+		bool seen_ = false; /*!< Found by the current device search */
+		float filtered_c_ = NAN; /*!< Smoothed temperature for checking short reads */
+		unsigned int short_reads_ = 0; /*!< Short reads since the last full read */
 
 	private:
-		const uint64_t id_;
+		uint64_t id_;
+	};
+
+	enum class State : uint8_t {
+		IDLE,
+		READING,
+		COLLECTING,
+		SCANNING,
 	};
 
+	using Devices = std::vector<Device, MemoryAllocator<Device, Memory::Subsystem::SENSORS>>;
+
 	Sensors() = default;
 	~Sensors() = default;
 
+	static const __FlashStringHelper *state_name(State state);
+
 	void start(int pin);
+	void configure();
 	void loop();
 
-	const std::vector<Device> devices() const;
+	void door_open(bool open);
 
-private:
-	enum class State {
-		IDLE,
-		READING,
-		SCANNING,
-	};
+	const Devices &devices() const;
+	unsigned long generation() const;
+	State state() const;
+
+	bool parasite() const;
+	unsigned long conversion_time_ms() const;
+
+	bool short_read() const;
+	unsigned long short_read_us() const;
+	unsigned long full_read_us() const;
+	unsigned long implausible_reads() const;
+
+	void trace(bool enabled);
+	const BusTrace &trace() const;
 
+private:
 	static constexpr size_t ADDR_LEN = 8;
 
 	static constexpr size_t SCRATCHPAD_LEN = 9;
 	static constexpr size_t SCRATCHPAD_TEMP_MSB = 1;
 	static constexpr size_t SCRATCHPAD_TEMP_LSB = 0;
+	static constexpr size_t SCRATCHPAD_ALARM_HIGH = 2;
+	static constexpr size_t SCRATCHPAD_ALARM_LOW = 3;
 	static constexpr size_t SCRATCHPAD_CONFIG = 4;
 
 	static constexpr uint8_t TYPE_DS18B20 = 0x28;
 
-	static constexpr unsigned long READ_INTERVAL_MS = 1000;
 	static constexpr unsigned long READ_TIMEOUT_MS = 2000;
+	static constexpr unsigned long READ_TIMEOUT_MARGIN_MS = 50;
+	static constexpr unsigned long MAX_CONVERSION_TIME_MS = 750;
+	static constexpr unsigned long DISCOVERY_INTERVAL_MS = 60000;
 	static constexpr unsigned long SCAN_TIMEOUT_MS = 30000;
 
+	static constexpr int FAST_RESOLUTION = 9;
+	static constexpr int SLOW_RESOLUTION = 12;
+	static constexpr unsigned long FAST_HOLD_MS = 60000;
+	static constexpr unsigned long SLOPE_WINDOW_MS = 60000;
+	static constexpr float STEEP_SLOPE_C_PER_MIN = 0.5f;
+
+	static constexpr unsigned int FULL_READ_INTERVAL = 16;
+	static constexpr float PLAUSIBLE_CHANGE_C = 2.0f;
+	static constexpr float POWER_ON_TEMPERATURE_C = 85.0f;
+
+	static constexpr size_t SUMMARY_LEN = 192;
+	static constexpr size_t SUMMARY_DEVICE_LEN = 1 + 20 + 8;
+
 	static constexpr uint8_t CMD_CONVERT_TEMP = 0x44;
+	static constexpr uint8_t CMD_WRITE_SCRATCHPAD = 0x4E;
 	static constexpr uint8_t CMD_READ_SCRATCHPAD = 0xBE;
+	static constexpr uint8_t CMD_READ_POWER_SUPPLY = 0xB4;
 
 	static uuid::log::Logger logger_;
 
+	uint8_t bus_reset();
+	void bus_skip();
+	void bus_select(const uint8_t addr[]);
+	void bus_write(uint8_t value, bool power = false);
+	uint8_t bus_read_bit();
+	uint8_t bus_poll();
+	void bus_poll_end();
+	void bus_read_bytes(uint8_t *data, size_t len);
+	void bus_reset_search();
+	bool bus_search(uint8_t addr[]);
+	void bus_depower();
+
+	bool fast_sampling();
+	bool set_resolution(int resolution);
 	bool temperature_convert_complete();
+	static float raw_temperature_c(uint8_t msb, uint8_t lsb, int resolution);
+	static void update_read_time(unsigned long &measured_us, unsigned long elapsed_us);
+
+	bool read_scratchpad(const uint8_t addr[], uint8_t scratchpad[]);
 	float get_temperature_c(const uint8_t addr[]);
+	float get_temperature_c_short(const uint8_t addr[]);
+	bool plausible(const Device &device, float temperature_c) const;
+	void discover();
+	void add_device(const uint8_t addr[]);
+	void read_device(Device &device);
+	void complete_cycle();
+	void read_power_supply();
+	static unsigned long nominal_conversion_time_ms(int resolution);
+	unsigned long conversion_time_ms(int resolution) const;
+	void update_conversion_time(int resolution, unsigned long elapsed_ms);
+	void reset_conversion_time(int resolution);
+	void update_slope(Device &device);
+	void log_summary();
 
 	OneWire bus_;
-	unsigned long last_activity_ = millis();
+	BusTrace trace_;
+	unsigned int polls_ = 0;
+	unsigned long poll_start_us_ = 0;
+	unsigned long poll_us_ = 0;
+	uint8_t poll_value_ = 0;
+	unsigned long last_activity_ = 0;
 	State state_ = State::IDLE;
-	std::vector<Device> found_;
-	std::vector<Device> devices_;
+	unsigned long generation_ = 0;
+	unsigned long fast_interval_ms_ = 0;
+	unsigned long slow_interval_ms_ = 0;
+	unsigned long interval_ms_ = 0;
+	int resolution_ = 0; /*!< Zero if unknown */
+	int convert_resolution_ = SLOW_RESOLUTION;
+	bool parasite_ = false;
+	std::array<unsigned long,SLOW_RESOLUTION - FAST_RESOLUTION + 1> conversion_time_ms_{};
+	bool door_open_ = false;
+	bool steep_ = false;
+	bool fast_event_ = false;
+	unsigned long fast_event_ms_ = 0;
+	unsigned long cycle_start_ms_ = 0;
+
+	unsigned long summary_interval_ms_ = 0;
+	unsigned long last_summary_ms_ = 0;
+	bool verbose_ = false;
+
+	bool short_read_ = false;
+	unsigned long short_read_us_ = 0;
+	unsigned long full_read_us_ = 0;
+	unsigned long implausible_reads_ = 0;
+
+	unsigned long reset_errors_ = 0;
+	unsigned long crc_errors_ = 0;
+	unsigned long timeouts_ = 0;
+	unsigned long summary_reset_errors_ = 0;
+	unsigned long summary_crc_errors_ = 0;
+	unsigned long summary_timeouts_ = 0;
+	Devices devices_;
+	size_t read_index_ = 0;
+	bool discovering_ = false;
+	unsigned long discovery_start_ms_ = 0;
+	unsigned long last_discovery_ms_ = 0;
 };
 
 } // namespace fridge
@@ -0,0 +1,90 @@
+/*
+ * fridge - Fridge Controller
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <esp_timer.h>
+
+#include <uuid/log.h>
+
+namespace fridge {
+
+/**
+ * Restarts if the main loop stops making progress, recording which part
+ * of the loop was running in RTC memory so that it can be reported after
+ * the restart.
+ */
+class Watchdog {
+public:
+	enum class Subsystem : uint8_t {
+		NONE,
+		APP,
+		DOOR,
+		SENSORS,
+		CONTROL,
+		COMPRESSOR,
+		ALARMS,
+		HISTORY,
+		MULTICAST,
+	};
+
+	struct Record {
+		uint32_t magic;
+		Subsystem subsystem;
+		uint8_t detail;
+		uint32_t stall_ms;
+		uint64_t uptime_ms;
+		uint32_t checksum;
+	};
+
+	Watchdog() = default;
+	~Watchdog() = default;
+
+	static const __FlashStringHelper *subsystem_name(Subsystem subsystem);
+	static const __FlashStringHelper *detail_name(const Record &record);
+
+	void start();
+	void configure();
+	void loop();
+
+	void enter(Subsystem subsystem, uint8_t detail = 0);
+
+	const Record *previous() const;
+
+private:
+	static constexpr uint32_t MAGIC = 0x57444F47;
+	static constexpr uint64_t CHECK_INTERVAL_US = 500 * 1000;
+
+	static uuid::log::Logger logger_;
+	static Record rtc_record_;
+
+	static void check(void *arg);
+	static uint32_t checksum(const Record &record);
+
+	esp_timer_handle_t timer_ = nullptr;
+	volatile unsigned long timeout_ms_ = 0;
+	volatile unsigned long progress_ms_ = 0;
+	volatile Subsystem subsystem_ = Subsystem::NONE;
+	volatile uint8_t detail_ = 0;
+	volatile bool fired_ = false;
+	bool has_previous_ = false;
+	Record previous_;
+};
+
+} // namespace fridge
@@ -0,0 +1,129 @@
+/*
+ * fridge - Fridge Controller
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fridge/history.h"
+
+#include <Arduino.h>
+
+#include <cmath>
+
+#include <uuid/common.h>
+#include <uuid/log.h>
+
+#include "fridge/sensors.h"
+
+static const char __pstr__logger_name[] __attribute__((__aligned__(sizeof(int)))) PROGMEM = "history";
+
+namespace fridge {
+
+uuid::log::Logger History::logger_{FPSTR(__pstr__logger_name), uuid::log::Facility::DAEMON};
+
+/*
+ * The whole buffer is allocated at startup so that it can't fail later
+ * because the heap has become fragmented.
+ */
+void History::start() {
+	samples_.resize(CAPACITY);
+	last_sample_ms_ = millis() - SAMPLE_INTERVAL_MS;
+}
+
+void History::loop(const Sensors::Devices &devices) {
+	if (millis() - last_sample_ms_ < SAMPLE_INTERVAL_MS) {
+		return;
+	}
+
+	uint32_t uptime_s = uuid::get_uptime_sec();
+
+	/*
+	 * Keep to the original schedule so that the time taken to notice that
+	 * a sample is due doesn't accumulate, unless a whole interval has been
+	 * missed.
+	 */
+	last_sample_ms_ += SAMPLE_INTERVAL_MS;
+	if (millis() - last_sample_ms_ >= SAMPLE_INTERVAL_MS) {
+		last_sample_ms_ = millis();
+	}
+
+	for (auto &device : devices) {
+		if (std::isnan(device.temperature_c_)) {
+			continue;
+		}
+
+		int index = device_index(device.id());
+
+		if (index < 0) {
+			continue;
+		}
+
+		Sample &sample = samples_[next_ % CAPACITY];
+
+		sample.uptime_s = uptime_s;
+		sample.temperature = std::lround(device.temperature_c_ * 16);
+		sample.device = index;
+		next_++;
+	}
+}
+
+uint32_t History::first() const {
+	return next_ > CAPACITY ? next_ - CAPACITY : 0;
+}
+
+uint32_t History::next() const {
+	return next_;
+}
+
+const History::Sample *History::sample(uint32_t sequence) const {
+	if ((int32_t)(sequence - first()) < 0 || (int32_t)(next_ - sequence) <= 0) {
+		return nullptr;
+	}
+
+	return &samples_[sequence % CAPACITY];
+}
+
+size_t History::device_count() const {
+	return device_count_;
+}
+
+uint64_t History::device_id(size_t index) const {
+	return index < device_count_ ? devices_[index] : 0;
+}
+
+/*
+ * Devices are never removed from the table because older samples may still
+ * refer to them.
+ */
+int History::device_index(uint64_t id) {
+	for (size_t i = 0; i < device_count_; i++) {
+		if (devices_[i] == id) {
+			return i;
+		}
+	}
+
+	if (device_count_ == devices_.size()) {
+		if (!devices_full_) {
+			logger_.warning(F("Too many devices, not recording %s"), Sensors::Device(id).to_string().c_str());
+			devices_full_ = true;
+		}
+		return -1;
+	}
+
+	devices_[device_count_] = id;
+	return device_count_++;
+}
+
+} // namespace fridge
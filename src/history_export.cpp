@@ -0,0 +1,174 @@
+/*
+ * fridge - Fridge Controller
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fridge/history_export.h"
+
+#include <Arduino.h>
+#include <mbedtls/base64.h>
+
+#include <array>
+#include <ctime>
+
+#include <uuid/common.h>
+
+#include "fridge/history.h"
+
+namespace fridge {
+
+void HistoryExport::begin(const History &history) {
+	state_ = State::HEADER;
+	sequence_ = history.first();
+	end_ = history.next();
+	count_ = 0;
+	lost_ = 0;
+}
+
+/*
+ * Returns the next line of the export, or nullptr when it's complete.
+ */
+const char *HistoryExport::next(const History &history) {
+	switch (state_) {
+	case State::HEADER: {
+			time_t now = time(nullptr);
+
+			start_frame(Frame::HEADER);
+			put(VERSION);
+			put32(uuid::get_uptime_sec());
+			put32(now >= MINIMUM_TIME ? now : 0);
+			put16(History::SAMPLE_INTERVAL_MS / 1000);
+			put(history.device_count());
+			for (size_t i = 0; i < history.device_count(); i++) {
+				put64(history.device_id(i));
+			}
+
+			state_ = State::SAMPLES;
+			return finish_frame();
+		}
+
+	case State::SAMPLES: {
+			std::array<int16_t, History::MAX_DEVICES> temperature{};
+			uint32_t uptime_s = 0;
+
+			uint32_t first = history.first();
+
+			/* Samples overwritten since the export started are skipped */
+			if ((int32_t)(first - sequence_) > 0) {
+				uint32_t skip_to = (int32_t)(first - end_) > 0 ? end_ : first;
+
+				lost_ += skip_to - sequence_;
+				sequence_ = skip_to;
+			}
+
+			start_frame(Frame::SAMPLES);
+			while (sequence_ != end_ && len_ + MAX_SAMPLE_LEN <= FRAME_HEADER_LEN + MAX_PAYLOAD_LEN) {
+				const History::Sample *sample = history.sample(sequence_++);
+				int16_t &previous = temperature[sample->device];
+				int32_t change = (int32_t)sample->temperature - previous;
+
+				put(sample->device);
+				put_varint(sample->uptime_s - uptime_s);
+				put_varint(((uint32_t)change << 1) ^ (uint32_t)(change >> 31));
+
+				uptime_s = sample->uptime_s;
+				previous = sample->temperature;
+				count_++;
+			}
+
+			if (sequence_ == end_) {
+				state_ = State::END;
+			}
+			return finish_frame();
+		}
+
+	case State::END:
+		start_frame(Frame::END);
+		put32(count_);
+		put32(lost_);
+
+		state_ = State::DONE;
+		return finish_frame();
+
+	case State::DONE:
+		break;
+	}
+
+	return nullptr;
+}
+
+void HistoryExport::start_frame(Frame type) {
+	frame_[0] = static_cast<uint8_t>(type);
+	len_ = FRAME_HEADER_LEN;
+}
+
+void HistoryExport::put(uint8_t value) {
+	frame_[len_++] = value;
+}
+
+void HistoryExport::put16(uint16_t value) {
+	put(value);
+	put(value >> 8);
+}
+
+void HistoryExport::put32(uint32_t value) {
+	put16(value);
+	put16(value >> 16);
+}
+
+void HistoryExport::put64(uint64_t value) {
+	put32(value);
+	put32(value >> 32);
+}
+
+void HistoryExport::put_varint(uint32_t value) {
+	while (value >= 0x80) {
+		put((value & 0x7F) | 0x80);
+		value >>= 7;
+	}
+	put(value);
+}
+
+const char *HistoryExport::finish_frame() {
+	size_t payload_len = len_ - FRAME_HEADER_LEN;
+	size_t olen = 0;
+
+	frame_[1] = payload_len;
+	frame_[2] = payload_len >> 8;
+	put16(crc16(frame_.data(), len_));
+
+	mbedtls_base64_encode(reinterpret_cast<unsigned char*>(line_.data()), line_.size(),
+		&olen, frame_.data(), len_);
+	line_[olen] = '\0';
+
+	return line_.data();
+}
+
+uint16_t HistoryExport::crc16(const uint8_t *data, size_t len) {
+	uint16_t crc = 0xFFFF;
+
+	for (size_t i = 0; i < len; i++) {
+		crc ^= (uint16_t)data[i] << 8;
+
+		for (int bit = 0; bit < 8; bit++) {
+			crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+		}
+	}
+
+	return crc;
+}
+
+} // namespace fridge
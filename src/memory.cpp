@@ -0,0 +1,85 @@
+/*
+ * fridge - Fridge Controller
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fridge/memory.h"
+
+#include <Arduino.h>
+
+#include <algorithm>
+#include <array>
+
+namespace fridge {
+
+std::array<Memory::Usage,Memory::SUBSYSTEMS> Memory::usage_;
+unsigned long Memory::rate_start_ms_ = 0;
+
+void Memory::loop() {
+	if (millis() - rate_start_ms_ >= RATE_INTERVAL_MS) {
+		for (auto& usage : usage_) {
+			usage.rate_per_min_ = usage.allocations_ - usage.rate_allocations_;
+			usage.rate_allocations_ = usage.allocations_;
+		}
+
+		rate_start_ms_ = millis();
+	}
+}
+
+void Memory::allocated(Subsystem subsystem, size_t size) {
+	auto &usage = usage_[static_cast<size_t>(subsystem)];
+
+	usage.current_ += size;
+	usage.peak_ = std::max(usage.peak_, usage.current_);
+	usage.allocations_++;
+}
+
+void Memory::freed(Subsystem subsystem, size_t size) {
+	auto &usage = usage_[static_cast<size_t>(subsystem)];
+
+	usage.current_ -= std::min(usage.current_, size);
+	usage.frees_++;
+}
+
+const Memory::Usage &Memory::usage(Subsystem subsystem) {
+	return usage_[static_cast<size_t>(subsystem)];
+}
+
+const __FlashStringHelper *Memory::subsystem_name(Subsystem subsystem) {
+	switch (subsystem) {
+	case Subsystem::SENSORS:
+		return F("sensors");
+
+	case Subsystem::TRACE:
+		return F("trace");
+
+	case Subsystem::CONSOLE:
+		return F("console");
+
+	case Subsystem::COMMANDS:
+		return F("commands");
+
+	case Subsystem::HISTORY:
+		return F("history");
+
+	case Subsystem::COUNT:
+		break;
+	}
+
+	return F("unknown");
+}
+
+} // namespace fridge
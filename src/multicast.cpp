@@ -0,0 +1,277 @@
+/*
+ * fridge - Fridge Controller
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fridge/multicast.h"
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string>
+
+#include <uuid/common.h>
+#include <uuid/log.h>
+
+#include "app/config.h"
+#include "fridge/sensors.h"
+
+static const char __pstr__logger_name[] __attribute__((__aligned__(sizeof(int)))) PROGMEM = "multicast";
+
+namespace fridge {
+
+uuid::log::Logger Multicast::logger_{FPSTR(__pstr__logger_name), uuid::log::Facility::DAEMON};
+
+IPAddress Multicast::group() {
+	return IPAddress(239, 255, 70, 68);
+}
+
+void Multicast::start() {
+	configure();
+	last_send_ms_ = millis() - SEND_INTERVAL_MS;
+}
+
+void Multicast::configure() {
+	app::Config config;
+	std::string hostname = config.hostname();
+
+	enabled_ = config.multicast_status();
+	hostname_.fill('\0');
+	hostname.copy(hostname_.data(), HOSTNAME_LEN);
+}
+
+/*
+ * The socket is only open while the network is connected because joining
+ * the group fails without an interface address.
+ */
+void Multicast::loop(const Sensors::Devices &devices, uint8_t flags) {
+	bool connected = enabled_ && WiFi.isConnected();
+
+	if (connected && !active_) {
+		if (udp_.beginMulticast(group(), PORT)) {
+			logger_.info(F("Joined multicast group"));
+			active_ = true;
+		}
+	} else if (!connected && active_) {
+		udp_.stop();
+		logger_.info(F("Left multicast group"));
+		active_ = false;
+	}
+
+	if (!active_) {
+		return;
+	}
+
+	receive();
+	expire();
+
+	if (millis() - last_send_ms_ >= SEND_INTERVAL_MS) {
+		send(devices, flags);
+		last_send_ms_ = millis();
+	}
+}
+
+void Multicast::send(const Sensors::Devices &devices, uint8_t flags) {
+	uint32_t uptime_s = uuid::get_uptime_sec();
+	size_t sensor_count = std::min(devices.size(), MAX_SENSORS);
+	size_t len = 0;
+	auto put = [this, &len] (uint64_t value, size_t size) {
+		for (size_t i = 0; i < size; i++) {
+			frame_[len++] = value >> (8 * i);
+		}
+	};
+
+	put(MAGIC, 4);
+	put(VERSION, 1);
+	put(flags, 1);
+	put(sensor_count, 1);
+	put(0, 1);
+	put(sequence_++, 4);
+	put(uptime_s, 4);
+	std::copy(hostname_.begin(), hostname_.begin() + HOSTNAME_LEN, &frame_[len]);
+	len += HOSTNAME_LEN;
+
+	for (size_t i = 0; i < MAX_SENSORS; i++) {
+		if (i < sensor_count && !std::isnan(devices[i].temperature_c_)) {
+			put(devices[i].id(), 8);
+			put((uint16_t)std::lround(devices[i].temperature_c_ * 16), 2);
+		} else {
+			put(i < sensor_count ? devices[i].id() : 0, 8);
+			put((uint16_t)UNKNOWN_TEMPERATURE, 2);
+		}
+	}
+
+	decode(self_);
+	self_.address = WiFi.localIP();
+	self_.last_seen_ms = millis();
+
+	if (udp_.beginMulticastPacket()
+			&& udp_.write(frame_.data(), frame_.size()) == frame_.size()
+			&& udp_.endPacket()) {
+		sent_++;
+	}
+}
+
+/*
+ * Only a few frames are processed on each loop pass so that a flood of
+ * traffic can't stall the rest of the application.
+ */
+void Multicast::receive() {
+	for (unsigned int i = 0; i < MAX_RECEIVE_PER_LOOP; i++) {
+		int len = udp_.parsePacket();
+
+		if (len <= 0) {
+			break;
+		}
+
+		uint32_t address = udp_.remoteIP();
+
+		if (len != (int)frame_.size() || udp_.read(frame_.data(), frame_.size()) != len) {
+			udp_.flush();
+			invalid_++;
+			continue;
+		}
+
+		Peer received;
+
+		if (!decode(received)) {
+			invalid_++;
+			continue;
+		}
+
+		if (address == (uint32_t)WiFi.localIP()) {
+			continue;
+		}
+
+		Peer *peer = find(address, received.hostname);
+
+		if (peer->address == address && std::strcmp(peer->hostname, received.hostname) == 0) {
+			uint32_t missing = received.sequence - peer->sequence - 1;
+
+			/* A restart starts the sequence again */
+			if (received.uptime_s >= peer->uptime_s && missing < 1000) {
+				received.lost = peer->lost + missing;
+			}
+		} else {
+			logger_.info(F("Found %s"), received.hostname);
+		}
+
+		*peer = received;
+		peer->address = address;
+		peer->last_seen_ms = millis();
+		received_++;
+	}
+}
+
+void Multicast::expire() {
+	for (auto &peer : peers_) {
+		if (peer.address != 0 && millis() - peer.last_seen_ms >= PEER_TIMEOUT_MS) {
+			logger_.notice(F("Lost %s"), peer.hostname);
+			peer = Peer{};
+		}
+	}
+}
+
+bool Multicast::decode(Peer &peer) const {
+	size_t len = 0;
+	auto get = [this, &len] (size_t size) -> uint64_t {
+		uint64_t value = 0;
+
+		for (size_t i = 0; i < size; i++) {
+			value |= (uint64_t)frame_[len++] << (8 * i);
+		}
+		return value;
+	};
+
+	if (get(4) != MAGIC || get(1) != VERSION) {
+		return false;
+	}
+
+	peer.flags = get(1);
+	peer.sensor_count = std::min((size_t)get(1), MAX_SENSORS);
+	get(1);
+	peer.sequence = get(4);
+	peer.uptime_s = get(4);
+	std::copy(&frame_[len], &frame_[len + HOSTNAME_LEN], peer.hostname);
+	peer.hostname[HOSTNAME_LEN] = '\0';
+	len += HOSTNAME_LEN;
+
+	for (size_t i = 0; i < MAX_SENSORS; i++) {
+		peer.ids[i] = get(8);
+		peer.temperatures[i] = (int16_t)get(2);
+	}
+
+	return true;
+}
+
+/*
+ * Peers are identified by hostname as well as address so that several
+ * simulated controllers can run on one host. If the table is full then
+ * the peer that was seen least recently is replaced.
+ */
+Multicast::Peer *Multicast::find(uint32_t address, const char *hostname) {
+	Peer *oldest = &peers_[0];
+
+	for (auto &peer : peers_) {
+		if (peer.address == address && std::strcmp(peer.hostname, hostname) == 0) {
+			return &peer;
+		}
+	}
+
+	for (auto &peer : peers_) {
+		if (peer.address == 0) {
+			return &peer;
+		} else if (millis() - peer.last_seen_ms > millis() - oldest->last_seen_ms) {
+			oldest = &peer;
+		}
+	}
+
+	return oldest;
+}
+
+bool Multicast::enabled() const {
+	return enabled_;
+}
+
+bool Multicast::active() const {
+	return active_;
+}
+
+unsigned long Multicast::sent() const {
+	return sent_;
+}
+
+unsigned long Multicast::received() const {
+	return received_;
+}
+
+unsigned long Multicast::invalid() const {
+	return invalid_;
+}
+
+const Multicast::Peer &Multicast::self() const {
+	return self_;
+}
+
+const std::array<Multicast::Peer,Multicast::MAX_PEERS> &Multicast::peers() const {
+	return peers_;
+}
+
+} // namespace fridge
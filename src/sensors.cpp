@@ -20,11 +20,18 @@
 
 #include <Arduino.h>
 
+#include <algorithm>
+#include <array>
+#include <cmath>
 #include <string>
 #include <vector>
 
 #include <uuid/log.h>
 
+#include "app/config.h"
+#include "fridge/bus_trace.h"
+#include "fridge/memory.h"
+
 static const char __pstr__logger_name[] __attribute__((__aligned__(sizeof(int)))) PROGMEM = "sensors";
 
 using uuid::log::Level;
@@ -34,112 +41,593 @@ namespace fridge {
 uuid::log::Logger Sensors::logger_{FPSTR(__pstr__logger_name), uuid::log::Facility::DAEMON};
 
 void Sensors::start(int pin) {
+	configure();
 	bus_.begin(pin);
+
+	last_activity_ = millis();
+	last_discovery_ms_ = millis() - DISCOVERY_INTERVAL_MS;
+	last_summary_ms_ = millis();
+}
+
+void Sensors::configure() {
+	app::Config config;
+
+	fast_interval_ms_ = config.sensors_fast_interval();
+	slow_interval_ms_ = config.sensors_slow_interval();
+	summary_interval_ms_ = config.sensors_summary_interval();
+	verbose_ = config.sensors_verbose();
+	short_read_ = config.sensors_short_read();
+}
+
+void Sensors::door_open(bool open) {
+	door_open_ = open;
 }
 
 void Sensors::loop() {
 	if (state_ == State::IDLE) {
-		if (millis() - last_activity_ >= READ_INTERVAL_MS) {
+		bool fast = fast_sampling();
+		unsigned long interval_ms = fast ? fast_interval_ms_ : slow_interval_ms_;
+
+		if (interval_ms != interval_ms_) {
+			logger_.debug(F("Sample interval %lums"), interval_ms);
+			interval_ms_ = interval_ms;
+		}
+
+		if (millis() - last_activity_ >= interval_ms_) {
+			int resolution = fast ? FAST_RESOLUTION : SLOW_RESOLUTION;
+
+			if (resolution != resolution_) {
+				set_resolution(resolution);
+			}
+
 			logger_.trace(F("Read temperature"));
-			if (bus_.reset()) {
-				bus_.skip();
-				bus_.write(CMD_CONVERT_TEMP);
+			if (bus_reset()) {
+				/*
+				 * Parasite powered devices need a strong pull-up for the
+				 * whole conversion and can't signal when it's complete.
+				 */
+				bus_skip();
+				bus_write(CMD_CONVERT_TEMP, parasite_);
 
 				state_ = State::READING;
+				cycle_start_ms_ = millis();
+				convert_resolution_ = resolution_ ? resolution_ : SLOW_RESOLUTION;
 			} else {
 				logger_.err(F("Bus reset failed"));
+				reset_errors_++;
 			}
 			last_activity_ = millis();
+		} else if (discovering_ || millis() - last_discovery_ms_ >= DISCOVERY_INTERVAL_MS) {
+			state_ = State::SCANNING;
 		}
 	} else if (state_ == State::READING) {
-		if (temperature_convert_complete()) {
-			logger_.trace(F("Scan bus for devices"));
-			bus_.reset_search();
-			found_.clear();
+		unsigned long elapsed_ms = millis() - last_activity_;
+		unsigned long expected_ms = conversion_time_ms(convert_resolution_);
 
-			state_ = State::SCANNING;
+		if (parasite_ ? elapsed_ms >= expected_ms
+				: (elapsed_ms >= expected_ms * 3 / 4 && temperature_convert_complete())) {
+			if (parasite_) {
+				bus_depower();
+			} else {
+				update_conversion_time(convert_resolution_, elapsed_ms);
+			}
+
+			read_index_ = 0;
+
+			state_ = State::COLLECTING;
 			last_activity_ = millis();
-		} else if (millis() - last_activity_ > READ_TIMEOUT_MS) {
+		} else if (elapsed_ms > std::min(expected_ms * 2 + READ_TIMEOUT_MARGIN_MS, READ_TIMEOUT_MS)) {
 			logger_.err(F("Temperature read timeout"));
+			timeouts_++;
+			bus_poll_end();
+			reset_conversion_time(convert_resolution_);
 
 			state_ = State::IDLE;
 			last_activity_ = millis();
 		}
-	} else if (state_ == State::SCANNING) {
-		if (millis() - last_activity_ > SCAN_TIMEOUT_MS) {
-			logger_.err(F("Device scan timeout"));
+	} else if (state_ == State::COLLECTING) {
+		if (read_index_ < devices_.size()) {
+			read_device(devices_[read_index_++]);
+		} else {
+			complete_cycle();
+
 			state_ = State::IDLE;
 			last_activity_ = millis();
-		} else {
-			uint8_t addr[ADDR_LEN] = { 0 };
-
-			if (bus_.search(addr)) {
-				bus_.depower();
-
-				if (bus_.crc8(addr, ADDR_LEN - 1) == addr[ADDR_LEN - 1]) {
-					switch (addr[0]) {
-					case TYPE_DS18B20:
-						found_.emplace_back(addr);
-
-						if (logger_.enabled(Level::TRACE)) {
-							logger_.trace(F("Found device %s"), found_.back().to_string().c_str());
-						}
-						found_.back().temperature_c_ = get_temperature_c(addr);
-						logger_.debug(F("Temperature of %s = %.2fC"), found_.back().to_string().c_str(), found_.back().temperature_c_);
-						break;
-
-					default:
-						if (logger_.enabled(Level::TRACE)) {
-							logger_.trace(F("Unknown device %s"), Device(addr).to_string().c_str());
-						}
-						break;
-					}
-				} else {
-					if (logger_.enabled(Level::TRACE)) {
-						logger_.trace(F("Invalid device %s"), Device(addr).to_string().c_str());
-					}
-				}
-			} else {
-				bus_.depower();
-				devices_ = std::move(found_);
-				found_.clear();
+		}
+	} else if (state_ == State::SCANNING) {
+		discover();
+
+		state_ = State::IDLE;
+	}
+}
+
+/*
+ * Discovery is performed one search step at a time between reads, so the
+ * position in the search is kept across loop passes until the bus has been
+ * fully enumerated. Devices not found by the end of a search are removed.
+ *
+ * A search that doesn't finish in time (e.g. because noise on the bus keeps
+ * producing new addresses) is abandoned without removing any devices.
+ */
+void Sensors::discover() {
+	uint8_t addr[ADDR_LEN] = { 0 };
+
+	if (!discovering_) {
+		logger_.trace(F("Scan bus for devices"));
+		bus_reset_search();
+
+		for (auto& device : devices_) {
+			device.seen_ = false;
+		}
+
+		discovering_ = true;
+		discovery_start_ms_ = millis();
+	} else if (millis() - discovery_start_ms_ > SCAN_TIMEOUT_MS) {
+		logger_.err(F("Device scan timeout"));
+		bus_reset_search();
 
+		discovering_ = false;
+		last_discovery_ms_ = millis();
+		return;
+	}
+
+	if (bus_search(addr)) {
+		bus_depower();
+
+		if (bus_.crc8(addr, ADDR_LEN - 1) == addr[ADDR_LEN - 1]) {
+			switch (addr[0]) {
+			case TYPE_DS18B20:
+				add_device(addr);
+				break;
+
+			default:
 				if (logger_.enabled(Level::TRACE)) {
-					if (devices_.size() == 1) {
-						logger_.trace(F("Found 1 device"));
-					} else {
-						logger_.trace(F("Found %zu devices"), devices_.size());
-					}
+					logger_.trace(F("Unknown device %s"), Device(addr).to_string().c_str());
 				}
+				break;
+			}
+		} else {
+			if (logger_.enabled(Level::TRACE)) {
+				logger_.trace(F("Invalid device %s"), Device(addr).to_string().c_str());
+			}
+		}
+	} else {
+		bus_depower();
 
-				state_ = State::IDLE;
-				last_activity_ = millis();
+		for (auto it = devices_.begin(); it != devices_.end(); ) {
+			if (it->seen_) {
+				++it;
+			} else {
+				logger_.info(F("Removed device %s"), it->to_string().c_str());
+				it = devices_.erase(it);
 			}
 		}
+
+		if (logger_.enabled(Level::TRACE)) {
+			if (devices_.size() == 1) {
+				logger_.trace(F("Found 1 device"));
+			} else {
+				logger_.trace(F("Found %zu devices"), devices_.size());
+			}
+		}
+
+		discovering_ = false;
+		last_discovery_ms_ = millis();
+
+		read_power_supply();
+	}
+}
+
+void Sensors::read_power_supply() {
+	if (!bus_reset()) {
+		logger_.err(F("Bus reset failed before reading power supply"));
+		reset_errors_++;
+		return;
+	}
+
+	bus_skip();
+	bus_write(CMD_READ_POWER_SUPPLY);
+
+	bool parasite = bus_read_bit() == 0;
+
+	if (parasite != parasite_) {
+		logger_.info(F("Power supply: %S"), parasite ? F("parasite") : F("external"));
+		parasite_ = parasite;
+	}
+}
+
+unsigned long Sensors::nominal_conversion_time_ms(int resolution) {
+	return MAX_CONVERSION_TIME_MS >> (SLOW_RESOLUTION - resolution);
+}
+
+unsigned long Sensors::conversion_time_ms(int resolution) const {
+	unsigned long nominal_ms = nominal_conversion_time_ms(resolution);
+
+	if (parasite_) {
+		return nominal_ms;
+	}
+
+	unsigned long measured_ms = conversion_time_ms_[resolution - FAST_RESOLUTION];
+
+	return measured_ms ? measured_ms : nominal_ms;
+}
+
+/*
+ * Measured conversion times include the delay until the next loop pass, so
+ * they will be slightly longer than the actual time.
+ *
+ * The read timeout is based on the measured time, so a measurement that is
+ * much too short (e.g. from a device that reported completion early) could
+ * cause every conversion to time out and never be corrected. Measurements
+ * are limited to half of the nominal time and discarded after a timeout.
+ */
+void Sensors::update_conversion_time(int resolution, unsigned long elapsed_ms) {
+	unsigned long &measured_ms = conversion_time_ms_[resolution - FAST_RESOLUTION];
+	unsigned long minimum_ms = nominal_conversion_time_ms(resolution) / 2;
+
+	if (measured_ms == 0) {
+		measured_ms = elapsed_ms;
+	} else {
+		measured_ms = (measured_ms * 3 + elapsed_ms) / 4;
+	}
+
+	measured_ms = std::max(measured_ms, minimum_ms);
+}
+
+void Sensors::reset_conversion_time(int resolution) {
+	conversion_time_ms_[resolution - FAST_RESOLUTION] = 0;
+}
+
+/*
+ * Read times are for the whole transaction including the resets, which is
+ * the time that the bus is unavailable for each device.
+ */
+void Sensors::update_read_time(unsigned long &measured_us, unsigned long elapsed_us) {
+	if (measured_us == 0) {
+		measured_us = elapsed_us;
+	} else {
+		measured_us = (measured_us * 7 + elapsed_us) / 8;
+	}
+}
+
+bool Sensors::parasite() const {
+	return parasite_;
+}
+
+unsigned long Sensors::conversion_time_ms() const {
+	return conversion_time_ms(resolution_ ? resolution_ : SLOW_RESOLUTION);
+}
+
+bool Sensors::short_read() const {
+	return short_read_;
+}
+
+unsigned long Sensors::short_read_us() const {
+	return short_read_us_;
+}
+
+unsigned long Sensors::full_read_us() const {
+	return full_read_us_;
+}
+
+unsigned long Sensors::implausible_reads() const {
+	return implausible_reads_;
+}
+
+void Sensors::add_device(const uint8_t addr[]) {
+	Device found{addr};
+	auto device = std::find_if(devices_.begin(), devices_.end(),
+		[&found] (const Device &other) { return other.id() == found.id(); });
+
+	if (logger_.enabled(Level::TRACE)) {
+		logger_.trace(F("Found device %s"), found.to_string().c_str());
+	}
+
+	if (device == devices_.end()) {
+		logger_.info(F("Added device %s"), found.to_string().c_str());
+
+		found.changed_ = generation_ + 1;
+		found.seen_ = true;
+		devices_.push_back(found);
+
+		/* New devices start with the default resolution */
+		resolution_ = 0;
+	} else {
+		device->seen_ = true;
+	}
+}
+
+void Sensors::read_device(Device &device) {
+	uint8_t addr[ADDR_LEN];
+
+	device.address(addr);
+
+	/*
+	 * Short reads depend on knowing the resolution that was used for the
+	 * conversion because the configuration register isn't read.
+	 */
+	bool full = !short_read_ || resolution_ == 0 || std::isnan(device.filtered_c_)
+		|| device.short_reads_ >= FULL_READ_INTERVAL;
+	unsigned long start_us = micros();
+	float temperature_c = NAN;
+
+	if (!full) {
+		temperature_c = get_temperature_c_short(addr);
+
+		if (plausible(device, temperature_c)) {
+			update_read_time(short_read_us_, micros() - start_us);
+			device.short_reads_++;
+		} else {
+			if (logger_.enabled(Level::DEBUG)) {
+				logger_.debug(F("Implausible short read of %s = %.2fC (expected %.2fC)"),
+					device.to_string().c_str(), temperature_c, device.filtered_c_);
+			}
+			implausible_reads_++;
+			full = true;
+		}
+	}
+
+	if (full) {
+		start_us = micros();
+		temperature_c = get_temperature_c(addr);
+		update_read_time(full_read_us_, micros() - start_us);
+		device.short_reads_ = 0;
+	}
+
+	/* CRC checked values are trusted and replace the filtered value */
+	if (full || std::isnan(temperature_c)) {
+		device.filtered_c_ = temperature_c;
+	} else {
+		device.filtered_c_ = (device.filtered_c_ * 3 + temperature_c) / 4;
+	}
+
+	if (std::isnan(temperature_c)) {
+		/* The device may have been removed */
+		last_discovery_ms_ = millis() - DISCOVERY_INTERVAL_MS;
+	}
+
+	if (!(temperature_c == device.temperature_c_
+			|| (std::isnan(temperature_c) && std::isnan(device.temperature_c_)))) {
+		device.changed_ = generation_ + 1;
+	}
+
+	device.temperature_c_ = temperature_c;
+	update_slope(device);
+
+	if (verbose_ && logger_.enabled(Level::DEBUG)) {
+		logger_.debug(F("Temperature of %s = %.2fC"), device.to_string().c_str(), device.temperature_c_);
+	}
+}
+
+/*
+ * Sample quickly at low resolution while the door is open or the temperature
+ * is changing rapidly, then continue for a while after the event has ended
+ * before returning to slow high resolution reads.
+ */
+bool Sensors::fast_sampling() {
+	if (door_open_ || steep_) {
+		fast_event_ = true;
+		fast_event_ms_ = millis();
+	} else if (fast_event_ && millis() - fast_event_ms_ >= FAST_HOLD_MS) {
+		fast_event_ = false;
+	}
+
+	return fast_event_;
+}
+
+/*
+ * The alarm bytes share the scratchpad write with the configuration
+ * register, so each device is written individually with the values it
+ * already has to avoid overwriting anything stored there.
+ */
+bool Sensors::set_resolution(int resolution) {
+	uint8_t config = ((resolution - 9) << 5) | 0x1F;
+	bool success = true;
+
+	for (auto& device : devices_) {
+		uint8_t addr[ADDR_LEN];
+		uint8_t scratchpad[SCRATCHPAD_LEN];
+
+		device.address(addr);
+
+		if (!read_scratchpad(addr, scratchpad)) {
+			success = false;
+			continue;
+		}
+
+		if (scratchpad[SCRATCHPAD_CONFIG] == config) {
+			continue;
+		}
+
+		if (!bus_reset()) {
+			logger_.err(F("Bus reset failed before writing scratchpad to %s"),
+					device.to_string().c_str());
+			reset_errors_++;
+			success = false;
+			continue;
+		}
+
+		bus_select(addr);
+		bus_write(CMD_WRITE_SCRATCHPAD);
+		bus_write(scratchpad[SCRATCHPAD_ALARM_HIGH]);
+		bus_write(scratchpad[SCRATCHPAD_ALARM_LOW]);
+		bus_write(config);
+	}
+
+	/*
+	 * Some devices may have been changed to the new resolution and others
+	 * not, so the resolution is unknown until it can be set on all of them.
+	 * Conversions are timed for the highest resolution until then.
+	 */
+	if (!success) {
+		resolution_ = 0;
+		return false;
+	}
+
+	logger_.debug(F("Resolution %d bits"), resolution);
+	resolution_ = resolution;
+	return true;
+}
+
+uint8_t Sensors::bus_reset() {
+	unsigned long start_us = micros();
+	uint8_t presence = bus_.reset();
+
+	if (trace_.enabled()) {
+		trace_.record(BusTrace::Operation::RESET, start_us, &presence, 1);
+	}
+	return presence;
+}
+
+void Sensors::bus_skip() {
+	unsigned long start_us = micros();
+
+	bus_.skip();
+
+	if (trace_.enabled()) {
+		trace_.record(BusTrace::Operation::SKIP, start_us);
+	}
+}
+
+void Sensors::bus_select(const uint8_t addr[]) {
+	unsigned long start_us = micros();
+
+	bus_.select(addr);
+
+	if (trace_.enabled()) {
+		trace_.record(BusTrace::Operation::SELECT, start_us, addr, ADDR_LEN);
+	}
+}
+
+void Sensors::bus_write(uint8_t value, bool power) {
+	unsigned long start_us = micros();
+
+	bus_.write(value, power ? 1 : 0);
+
+	if (trace_.enabled()) {
+		trace_.record(BusTrace::Operation::WRITE, start_us, &value, 1);
+	}
+}
+
+uint8_t Sensors::bus_read_bit() {
+	unsigned long start_us = micros();
+	uint8_t value = bus_.read_bit();
+
+	if (trace_.enabled()) {
+		trace_.record(BusTrace::Operation::READ_BIT, start_us, &value, 1);
+	}
+	return value;
+}
+
+uint8_t Sensors::bus_poll() {
+	unsigned long start_us = micros();
+	uint8_t value = bus_.read_bit();
+
+	if (trace_.enabled()) {
+		polls_ = std::min(polls_ + 1, 0xFFFFU);
+		poll_start_us_ = start_us;
+		poll_us_ += micros() - start_us;
+		poll_value_ = value;
 	}
+	return value;
+}
+
+void Sensors::bus_poll_end() {
+	if (polls_ > 0 && trace_.enabled()) {
+		uint8_t data[] = {
+			(uint8_t)polls_, (uint8_t)(polls_ >> 8), poll_value_,
+			(uint8_t)poll_us_, (uint8_t)(poll_us_ >> 8),
+			(uint8_t)(poll_us_ >> 16), (uint8_t)(poll_us_ >> 24),
+		};
+
+		trace_.record(BusTrace::Operation::POLL, poll_start_us_, data, sizeof(data));
+	}
+
+	polls_ = 0;
+	poll_us_ = 0;
+}
+
+void Sensors::bus_read_bytes(uint8_t *data, size_t len) {
+	unsigned long start_us = micros();
+
+	bus_.read_bytes(data, len);
+
+	if (trace_.enabled()) {
+		trace_.record(BusTrace::Operation::READ_BYTES, start_us, data, len);
+	}
+}
+
+void Sensors::bus_reset_search() {
+	unsigned long start_us = micros();
+
+	bus_.reset_search();
+
+	if (trace_.enabled()) {
+		trace_.record(BusTrace::Operation::RESET_SEARCH, start_us);
+	}
+}
+
+bool Sensors::bus_search(uint8_t addr[]) {
+	unsigned long start_us = micros();
+	bool found = bus_.search(addr);
+
+	if (trace_.enabled()) {
+		uint8_t data[1 + ADDR_LEN];
+
+		data[0] = found ? 1 : 0;
+		std::copy(addr, addr + ADDR_LEN, &data[1]);
+		trace_.record(BusTrace::Operation::SEARCH, start_us, data, sizeof(data));
+	}
+	return found;
+}
+
+void Sensors::bus_depower() {
+	unsigned long start_us = micros();
+
+	bus_.depower();
+
+	if (trace_.enabled()) {
+		trace_.record(BusTrace::Operation::DEPOWER, start_us);
+	}
+}
+
+void Sensors::trace(bool enabled) {
+	if (enabled) {
+		trace_.enable();
+	} else {
+		trace_.disable();
+	}
+}
+
+const BusTrace &Sensors::trace() const {
+	return trace_;
 }
 
 bool Sensors::temperature_convert_complete() {
-	return bus_.read_bit() == 1;
+	if (bus_poll() == 1) {
+		bus_poll_end();
+		return true;
+	}
+	return false;
 }
 
-float Sensors::get_temperature_c(const uint8_t addr[]) {
-	if (!bus_.reset()) {
+bool Sensors::read_scratchpad(const uint8_t addr[], uint8_t scratchpad[]) {
+	if (!bus_reset()) {
 		logger_.err(F("Bus reset failed before reading scratchpad from %s"),
 				Device(addr).to_string().c_str());
-		return NAN;
+		reset_errors_++;
+		return false;
 	}
 
-	uint8_t scratchpad[SCRATCHPAD_LEN] = { 0 };
+	bus_select(addr);
+	bus_write(CMD_READ_SCRATCHPAD);
+	bus_read_bytes(scratchpad, SCRATCHPAD_LEN);
 
-	bus_.select(addr);
-	bus_.write(CMD_READ_SCRATCHPAD);
-	bus_.read_bytes(scratchpad, SCRATCHPAD_LEN);
-
-	if (!bus_.reset()) {
+	if (!bus_reset()) {
 		logger_.err(F("Bus reset failed after reading scratchpad from %s"),
 				Device(addr).to_string().c_str());
-		return NAN;
+		reset_errors_++;
+		return false;
 	}
 
 	if (bus_.crc8(scratchpad, SCRATCHPAD_LEN - 1) != scratchpad[SCRATCHPAD_LEN - 1]) {
@@ -147,13 +635,77 @@ float Sensors::get_temperature_c(const uint8_t addr[]) {
 				scratchpad[0], scratchpad[1], scratchpad[2], scratchpad[3],
 				scratchpad[4], scratchpad[5], scratchpad[6], scratchpad[7],
 				scratchpad[8], Device(addr).to_string().c_str());
+		crc_errors_++;
+		return false;
+	}
+
+	return true;
+}
+
+float Sensors::get_temperature_c(const uint8_t addr[]) {
+	uint8_t scratchpad[SCRATCHPAD_LEN] = { 0 };
+
+	if (!read_scratchpad(addr, scratchpad)) {
 		return NAN;
 	}
 
-	int16_t raw_value = ((int16_t)scratchpad[SCRATCHPAD_TEMP_MSB] << 8) | scratchpad[SCRATCHPAD_TEMP_LSB];
+	int resolution = 9 + ((scratchpad[SCRATCHPAD_CONFIG] >> 5) & 0x3);
+
+	return raw_temperature_c(scratchpad[SCRATCHPAD_TEMP_MSB], scratchpad[SCRATCHPAD_TEMP_LSB], resolution);
+}
+
+/*
+ * Only the temperature bytes are read and there's no CRC to check, so the
+ * value is only used if it's plausible. The reset stops the device sending
+ * the rest of the scratchpad.
+ */
+float Sensors::get_temperature_c_short(const uint8_t addr[]) {
+	if (!bus_reset()) {
+		logger_.err(F("Bus reset failed before reading scratchpad from %s"),
+				Device(addr).to_string().c_str());
+		reset_errors_++;
+		return NAN;
+	}
+
+	uint8_t scratchpad[SCRATCHPAD_TEMP_MSB + 1] = { 0 };
+
+	bus_select(addr);
+	bus_write(CMD_READ_SCRATCHPAD);
+	bus_read_bytes(scratchpad, sizeof(scratchpad));
+
+	if (!bus_reset()) {
+		logger_.err(F("Bus reset failed after reading scratchpad from %s"),
+				Device(addr).to_string().c_str());
+		reset_errors_++;
+		return NAN;
+	}
+
+	/*
+	 * A device that has stopped responding reads as all ones, which is a
+	 * valid temperature (-0.0625°C, or -0.5°C once it has been masked to a
+	 * lower resolution) so it has to be rejected before conversion.
+	 */
+	if (scratchpad[SCRATCHPAD_TEMP_MSB] == 0xFF && scratchpad[SCRATCHPAD_TEMP_LSB] == 0xFF) {
+		return NAN;
+	}
+
+	return raw_temperature_c(scratchpad[SCRATCHPAD_TEMP_MSB], scratchpad[SCRATCHPAD_TEMP_LSB], convert_resolution_);
+}
+
+/*
+ * A device that has been reset without a conversion reads as 85°C, which
+ * would otherwise be accepted if the filtered value is very close to it.
+ */
+bool Sensors::plausible(const Device &device, float temperature_c) const {
+	return !std::isnan(temperature_c)
+		&& temperature_c != POWER_ON_TEMPERATURE_C
+		&& std::abs(temperature_c - device.filtered_c_) <= PLAUSIBLE_CHANGE_C;
+}
+
+float Sensors::raw_temperature_c(uint8_t msb, uint8_t lsb, int resolution) {
+	int16_t raw_value = ((int16_t)msb << 8) | lsb;
 
 	// Adjust based on device resolution
-	int resolution = 9 + ((scratchpad[SCRATCHPAD_CONFIG] >> 5) & 0x3);
 	switch (resolution) {
 	case 9:
 		raw_value &= ~0x1;
@@ -174,10 +726,120 @@ float Sensors::get_temperature_c(const uint8_t addr[]) {
 	return (float)raw_value / 16;
 }
 
-const std::vector<Sensors::Device> Sensors::devices() const {
+void Sensors::complete_cycle() {
+	generation_++;
+	steep_ = false;
+
+	for (auto& device : devices_) {
+		if (std::abs(device.slope_c_per_min_) > STEEP_SLOPE_C_PER_MIN) {
+			steep_ = true;
+		}
+	}
+
+	if (trace_.enabled()) {
+		uint8_t data[2] = { (uint8_t)devices_.size(), (uint8_t)(devices_.size() >> 8) };
+
+		trace_.record(BusTrace::Operation::CYCLE, micros(), data, sizeof(data));
+	}
+
+	if (millis() - last_summary_ms_ >= summary_interval_ms_) {
+		log_summary();
+		last_summary_ms_ = millis();
+	}
+}
+
+/*
+ * The slope is measured over a fixed window so that it isn't dominated by
+ * quantisation of low resolution readings.
+ */
+void Sensors::update_slope(Device &device) {
+	if (std::isnan(device.temperature_c_)) {
+		return;
+	}
+
+	if (std::isnan(device.reference_c_)) {
+		device.reference_c_ = device.temperature_c_;
+		device.reference_ms_ = millis();
+		return;
+	}
+
+	unsigned long elapsed_ms = millis() - device.reference_ms_;
+
+	if (elapsed_ms >= SLOPE_WINDOW_MS) {
+		device.slope_c_per_min_ = (device.temperature_c_ - device.reference_c_) * 60000 / elapsed_ms;
+		device.reference_c_ = device.temperature_c_;
+		device.reference_ms_ = millis();
+	}
+}
+
+/*
+ * Summarise the whole scan in one message instead of one for every device,
+ * splitting it only if there are too many devices to fit.
+ */
+void Sensors::log_summary() {
+	if (!logger_.enabled(Level::DEBUG)) {
+		return;
+	}
+
+	unsigned long reset_errors = reset_errors_ - summary_reset_errors_;
+	unsigned long crc_errors = crc_errors_ - summary_crc_errors_;
+	unsigned long timeouts = timeouts_ - summary_timeouts_;
+	std::array<char, SUMMARY_LEN> line;
+	size_t len = 0;
+
+	summary_reset_errors_ = reset_errors_;
+	summary_crc_errors_ = crc_errors_;
+	summary_timeouts_ = timeouts_;
+
+	for (auto& device : devices_) {
+		if (len + SUMMARY_DEVICE_LEN >= line.size()) {
+			line[len] = '\0';
+			logger_.debug(F("Scan%s"), line.data());
+			len = 0;
+		}
+
+		line[len++] = ' ';
+		len += device.to_string(&line[len], line.size() - len);
+		len += std::max(0, ::snprintf_P(&line[len], line.size() - len, PSTR("=%.2f"), device.temperature_c_));
+		len = std::min(len, line.size() - 1);
+	}
+	line[len] = '\0';
+
+	logger_.debug(F("Scan%s in %lums (errors: %lu reset, %lu CRC, %lu timeout)"),
+		line.data(), millis() - cycle_start_ms_,
+		reset_errors, crc_errors, timeouts);
+}
+
+const Sensors::Devices &Sensors::devices() const {
 	return devices_;
 }
 
+unsigned long Sensors::generation() const {
+	return generation_;
+}
+
+Sensors::State Sensors::state() const {
+	return state_;
+}
+
+const __FlashStringHelper *Sensors::state_name(State state) {
+	switch (state) {
+	case State::IDLE:
+		return F("IDLE");
+
+	case State::READING:
+		return F("READING");
+
+	case State::COLLECTING:
+		return F("COLLECTING");
+
+	case State::SCANNING:
+		return F("SCANNING");
+	}
+
+	return F("UNKNOWN");
+}
+
 Sensors::Device::Device(const uint8_t addr[])
 		: id_(((uint64_t)addr[0] << 56)
 				| ((uint64_t)addr[1] << 48)
@@ -190,14 +852,30 @@ Sensors::Device::Device(const uint8_t addr[])
 
 }
 
+Sensors::Device::Device(uint64_t id) : id_(id) {
+
+}
+
 uint64_t Sensors::Device::id() const {
 	return id_;
 }
 
+void Sensors::Device::address(uint8_t addr[]) const {
+	for (size_t i = 0; i < ADDR_LEN; i++) {
+		addr[i] = id_ >> (8 * (ADDR_LEN - 1 - i));
+	}
+}
+
 std::string Sensors::Device::to_string() const {
 	std::string str(20, '\0');
 
-	::snprintf_P(&str[0], str.capacity() + 1,
+	to_string(&str[0], str.capacity() + 1);
+
+	return str;
+}
+
+size_t Sensors::Device::to_string(char *str, size_t len) const {
+	int ret = ::snprintf_P(str, len,
 			PSTR("%02X-%04X-%04X-%04X-%02X"),
 			(unsigned int)(id_ >> 56) & 0xFF,
 			(unsigned int)(id_ >> 40) & 0xFFFF,
@@ -205,7 +883,7 @@ std::string Sensors::Device::to_string() const {
 			(unsigned int)(id_ >> 8) & 0xFFFF,
 			(unsigned int)(id_) & 0xFF);
 
-	return str;
+	return ret > 0 ? std::min((size_t)ret, len - 1) : 0;
 }
 
 } // namespace fridge
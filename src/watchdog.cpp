@@ -0,0 +1,169 @@
+/*
+ * fridge - Fridge Controller
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fridge/watchdog.h"
+
+#include <Arduino.h>
+#include <esp_system.h>
+#include <esp_timer.h>
+
+#include <uuid/common.h>
+#include <uuid/log.h>
+
+#include "app/config.h"
+#include "fridge/sensors.h"
+
+static const char __pstr__logger_name[] __attribute__((__aligned__(sizeof(int)))) PROGMEM = "watchdog";
+
+namespace fridge {
+
+uuid::log::Logger Watchdog::logger_{FPSTR(__pstr__logger_name), uuid::log::Facility::DAEMON};
+
+RTC_NOINIT_ATTR Watchdog::Record Watchdog::rtc_record_;
+
+void Watchdog::start() {
+	if (rtc_record_.magic == MAGIC && rtc_record_.checksum == checksum(rtc_record_)) {
+		previous_ = rtc_record_;
+		has_previous_ = true;
+
+		logger_.alert(F("Restarted after main loop stalled in %S (%S) for %lums (uptime %s)"),
+			subsystem_name(previous_.subsystem), detail_name(previous_),
+			(unsigned long)previous_.stall_ms,
+			uuid::log::format_timestamp_ms(previous_.uptime_ms).c_str());
+	}
+
+	rtc_record_.magic = 0;
+
+	configure();
+	progress_ms_ = millis();
+
+	const esp_timer_create_args_t args = {
+		.callback = check,
+		.arg = this,
+		.dispatch_method = ESP_TIMER_TASK,
+		.name = "watchdog",
+		.skip_unhandled_events = true,
+	};
+
+	if (esp_timer_create(&args, &timer_) != ESP_OK
+			|| esp_timer_start_periodic(timer_, CHECK_INTERVAL_US) != ESP_OK) {
+		logger_.crit(F("Unable to start timer"));
+	}
+}
+
+void Watchdog::configure() {
+	app::Config config;
+
+	timeout_ms_ = config.watchdog_timeout();
+}
+
+void Watchdog::loop() {
+	progress_ms_ = millis();
+	subsystem_ = Subsystem::NONE;
+}
+
+void Watchdog::enter(Subsystem subsystem, uint8_t detail) {
+	detail_ = detail;
+	subsystem_ = subsystem;
+}
+
+const Watchdog::Record *Watchdog::previous() const {
+	return has_previous_ ? &previous_ : nullptr;
+}
+
+/*
+ * Runs in the timer task so that it still runs while the main loop is
+ * stuck.
+ */
+void Watchdog::check(void *arg) {
+	Watchdog *watchdog = reinterpret_cast<Watchdog*>(arg);
+	unsigned long timeout_ms = watchdog->timeout_ms_;
+	unsigned long stall_ms = millis() - watchdog->progress_ms_;
+
+	if (timeout_ms == 0 || stall_ms < timeout_ms || watchdog->fired_) {
+		return;
+	}
+
+	watchdog->fired_ = true;
+
+	rtc_record_.magic = MAGIC;
+	rtc_record_.subsystem = watchdog->subsystem_;
+	rtc_record_.detail = watchdog->detail_;
+	rtc_record_.stall_ms = stall_ms;
+	rtc_record_.uptime_ms = uuid::get_uptime_ms();
+	rtc_record_.checksum = checksum(rtc_record_);
+
+	esp_restart();
+}
+
+uint32_t Watchdog::checksum(const Record &record) {
+	uint32_t value = MAGIC;
+
+	value = (value * 31) ^ static_cast<uint8_t>(record.subsystem);
+	value = (value * 31) ^ record.detail;
+	value = (value * 31) ^ record.stall_ms;
+	value = (value * 31) ^ (uint32_t)(record.uptime_ms >> 32);
+	value = (value * 31) ^ (uint32_t)record.uptime_ms;
+
+	return value;
+}
+
+const __FlashStringHelper *Watchdog::subsystem_name(Subsystem subsystem) {
+	switch (subsystem) {
+	case Subsystem::NONE:
+		return F("none");
+
+	case Subsystem::APP:
+		return F("app::App::loop");
+
+	case Subsystem::DOOR:
+		return F("Door::loop");
+
+	case Subsystem::SENSORS:
+		return F("Sensors::loop");
+
+	case Subsystem::CONTROL:
+		return F("App::control");
+
+	case Subsystem::COMPRESSOR:
+		return F("Compressor::loop");
+
+	case Subsystem::ALARMS:
+		return F("App::check_alarms");
+
+	case Subsystem::HISTORY:
+		return F("History::loop");
+
+	case Subsystem::MULTICAST:
+		return F("Multicast::loop");
+	}
+
+	return F("unknown");
+}
+
+const __FlashStringHelper *Watchdog::detail_name(const Record &record) {
+	switch (record.subsystem) {
+	case Subsystem::SENSORS:
+		return Sensors::state_name(static_cast<Sensors::State>(record.detail));
+
+	default:
+		return F("-");
+	}
+}
+
+} // namespace fridge
@@ -0,0 +1,44 @@
+/*
+ * fridge - Fridge Controller
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "app/config.h"
+
+#include <string>
+
+namespace app {
+
+#define MCU_APP_CONFIG_CUSTOM(type, prefix, name, suffix, default_value, ...) \
+	type Config::name##_ = default_value; \
+	type Config::name() const { return name##_; }
+
+MCU_APP_CONFIG_DATA
+
+void Config::commit() {
+}
+
+static std::string current_hostname = "host";
+
+std::string Config::hostname() const {
+	return current_hostname;
+}
+
+void Config::hostname(const std::string &hostname) {
+	current_hostname = hostname;
+}
+
+} // namespace app
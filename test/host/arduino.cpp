@@ -0,0 +1,206 @@
+/*
+ * fridge - Fridge Controller
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Arduino.h>
+
+#include <array>
+#include <cstdarg>
+#include <cstdio>
+#include <string>
+
+#include <uuid/common.h>
+#include <uuid/log.h>
+
+static unsigned long clock_start_ms = 0;
+static uint64_t clock_us = 0;
+static std::array<int,64> pins{};
+
+unsigned long millis() {
+	return clock_start_ms + (unsigned long)(clock_us / 1000);
+}
+
+unsigned long micros() {
+	return clock_start_ms * 1000UL + (unsigned long)clock_us;
+}
+
+void delay(unsigned long ms) {
+	host::clock_advance_us((uint64_t)ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+	host::clock_advance_us(us);
+}
+
+void yield() {
+}
+
+void pinMode(int pin __attribute__((unused)), int mode __attribute__((unused))) {
+}
+
+void digitalWrite(int pin, int value) {
+	pins.at(pin) = value;
+}
+
+int digitalRead(int pin) {
+	return pins.at(pin);
+}
+
+namespace host {
+
+void clock_start(unsigned long millis) {
+	clock_start_ms = millis;
+	clock_us = 0;
+}
+
+void clock_advance_us(uint64_t us) {
+	clock_us += us;
+}
+
+uint64_t clock_elapsed_us() {
+	return clock_us;
+}
+
+int pin_value(int pin) {
+	return pins.at(pin);
+}
+
+void pin_input(int pin, int value) {
+	pins.at(pin) = value;
+}
+
+} // namespace host
+
+namespace uuid {
+
+std::string read_flash_string(const __FlashStringHelper *flash_str) {
+	return reinterpret_cast<const char *>(flash_str);
+}
+
+/*
+ * Like the library, this must be called at least once per wrap of millis(),
+ * but it starts from zero wherever the clock was started.
+ */
+uint64_t get_uptime_ms() {
+	static uint64_t uptime_ms = 0;
+	static unsigned long last_millis = 0;
+	static bool started = false;
+	unsigned long now_millis = ::millis();
+
+	if (!started) {
+		last_millis = now_millis;
+		started = true;
+	}
+
+	uptime_ms += now_millis - last_millis;
+	last_millis = now_millis;
+	return uptime_ms;
+}
+
+uint32_t get_uptime() {
+	return (uint32_t)get_uptime_ms();
+}
+
+uint32_t get_uptime_sec() {
+	return get_uptime_ms() / 1000;
+}
+
+void loop() {
+	get_uptime_ms();
+}
+
+namespace log {
+
+Level Logger::level_ = Level::WARNING;
+std::array<unsigned long,10> Logger::counts_{};
+
+Logger::Logger(const __FlashStringHelper *name, Facility facility __attribute__((unused)))
+		: name_(reinterpret_cast<const char *>(name)) {
+}
+
+void Logger::level(Level level) {
+	level_ = level;
+}
+
+unsigned long Logger::count(Level level) {
+	return counts_[static_cast<int>(level)];
+}
+
+bool Logger::enabled(Level level) const {
+	return level <= level_;
+}
+
+/* Flash strings are normal strings here, so "%S" is the same as "%s" */
+void Logger::vlog(Level level, const __FlashStringHelper *format, va_list ap) const {
+	counts_[static_cast<int>(level)]++;
+
+	if (!enabled(level)) {
+		return;
+	}
+
+	std::string text = reinterpret_cast<const char *>(format);
+
+	for (size_t i = 0; i + 1 < text.size(); i++) {
+		if (text[i] == '%' && text[i + 1] == '%') {
+			i++;
+		} else if (text[i] == '%' && text[i + 1] == 'S') {
+			text[i + 1] = 's';
+		}
+	}
+
+	char message[256];
+
+	vsnprintf(message, sizeof(message), text.c_str(), ap);
+	fprintf(stderr, "%s %d %s: %s\n",
+		uuid::log::format_timestamp_ms(uuid::get_uptime_ms()).c_str(),
+		static_cast<int>(level), name_, message);
+}
+
+#define LOGGER_LEVEL(method, value) \
+	void Logger::method(const __FlashStringHelper *format, ...) const { \
+		va_list ap; \
+		va_start(ap, format); \
+		vlog(Level::value, format, ap); \
+		va_end(ap); \
+	}
+
+LOGGER_LEVEL(emerg, EMERG)
+LOGGER_LEVEL(alert, ALERT)
+LOGGER_LEVEL(crit, CRIT)
+LOGGER_LEVEL(err, ERR)
+LOGGER_LEVEL(warning, WARNING)
+LOGGER_LEVEL(notice, NOTICE)
+LOGGER_LEVEL(info, INFO)
+LOGGER_LEVEL(debug, DEBUG)
+LOGGER_LEVEL(trace, TRACE)
+
+std::string format_timestamp_ms(uint64_t timestamp_ms, unsigned int days_width) {
+	char text[32];
+
+	snprintf(text, sizeof(text), "%0*lu+%02u:%02u:%02u.%03u", days_width,
+		(unsigned long)(timestamp_ms / 86400000),
+		(unsigned int)(timestamp_ms / 3600000 % 24),
+		(unsigned int)(timestamp_ms / 60000 % 60),
+		(unsigned int)(timestamp_ms / 1000 % 60),
+		(unsigned int)(timestamp_ms % 1000));
+
+	return text;
+}
+
+} // namespace log
+
+} // namespace uuid
@@ -0,0 +1,53 @@
+/*
+ * fridge - Fridge Controller
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <mbedtls/base64.h>
+
+#include <cstddef>
+#include <cstdint>
+
+static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+int mbedtls_base64_encode(unsigned char *dst, size_t dlen, size_t *olen, const unsigned char *src, size_t slen) {
+	size_t len = (slen + 2) / 3 * 4;
+
+	if (dlen < len + 1) {
+		*olen = len + 1;
+		return MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL;
+	}
+
+	for (size_t i = 0; i < slen; i += 3) {
+		uint32_t value = (uint32_t)src[i] << 16;
+
+		if (i + 1 < slen) {
+			value |= (uint32_t)src[i + 1] << 8;
+		}
+		if (i + 2 < slen) {
+			value |= src[i + 2];
+		}
+
+		*dst++ = alphabet[(value >> 18) & 0x3F];
+		*dst++ = alphabet[(value >> 12) & 0x3F];
+		*dst++ = i + 1 < slen ? alphabet[(value >> 6) & 0x3F] : '=';
+		*dst++ = i + 2 < slen ? alphabet[value & 0x3F] : '=';
+	}
+
+	*dst = '\0';
+	*olen = len;
+	return 0;
+}
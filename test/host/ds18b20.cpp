@@ -0,0 +1,243 @@
+/*
+ * fridge - Fridge Controller
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ds18b20.h"
+
+#include <Arduino.h>
+#include <OneWire.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace host {
+
+size_t DS18B20Bus::add(uint64_t serial) {
+	Sensor sensor;
+
+	sensor.address[0] = 0x28;
+	for (size_t i = 1; i < 7; i++) {
+		sensor.address[i] = serial >> (8 * (i - 1));
+	}
+	sensor.address[7] = OneWire::crc8(sensor.address.data(), 7);
+	sensor.scratchpad = { 0x50, 0x05, 0x4B, 0x46, 0x7F, 0xFF, 0x0C, 0x10, 0x00 };
+	update_scratchpad(sensor);
+
+	sensors_.push_back(sensor);
+	std::sort(sensors_.begin(), sensors_.end(),
+		[] (const Sensor &a, const Sensor &b) { return a.address < b.address; });
+
+	for (size_t i = 0; i < sensors_.size(); i++) {
+		if (sensors_[i].address == sensor.address) {
+			return i;
+		}
+	}
+	return 0;
+}
+
+DS18B20Bus::Sensor &DS18B20Bus::sensor(size_t index) {
+	return sensors_.at(index);
+}
+
+size_t DS18B20Bus::size() const {
+	return sensors_.size();
+}
+
+void DS18B20Bus::corrupt_reads(unsigned long interval) {
+	corrupt_interval_ = interval;
+}
+
+unsigned long DS18B20Bus::operations() const {
+	return operations_;
+}
+
+unsigned long DS18B20Bus::conversions() const {
+	return conversions_;
+}
+
+unsigned long DS18B20Bus::scratchpad_reads() const {
+	return scratchpad_reads_;
+}
+
+unsigned long DS18B20Bus::corrupted_reads() const {
+	return corrupted_reads_;
+}
+
+void DS18B20Bus::elapse(uint64_t us) {
+	operations_++;
+	clock_advance_us(us);
+}
+
+bool DS18B20Bus::selected(const Sensor &sensor) const {
+	return sensor.present && (all_ || sensor.address == rom_);
+}
+
+/* The conversion result is only visible once the conversion has completed */
+void DS18B20Bus::convert(Sensor &sensor) {
+	int resolution = 9 + ((sensor.scratchpad[4] >> 5) & 3);
+
+	sensor.converted_raw = std::lround(sensor.temperature_c * 16) & ~((1 << (12 - resolution)) - 1);
+	sensor.conversion_end_us = clock_elapsed_us() + (750000 >> (12 - resolution)) * 9 / 10;
+	conversions_++;
+}
+
+void DS18B20Bus::update_scratchpad(Sensor &sensor) {
+	sensor.scratchpad[0] = sensor.converted_raw;
+	sensor.scratchpad[1] = sensor.converted_raw >> 8;
+	sensor.scratchpad[8] = OneWire::crc8(sensor.scratchpad.data(), 8);
+}
+
+uint8_t DS18B20Bus::reset() {
+	elapse(RESET_US);
+	command_ = Command::NONE;
+	all_ = false;
+	rom_.fill(0);
+
+	return std::any_of(sensors_.begin(), sensors_.end(),
+		[] (const Sensor &sensor) { return sensor.present; }) ? 1 : 0;
+}
+
+void DS18B20Bus::select(const uint8_t rom[8]) {
+	elapse(9 * BYTE_US);
+	std::copy(rom, rom + 8, rom_.begin());
+}
+
+void DS18B20Bus::skip() {
+	elapse(BYTE_US);
+	all_ = true;
+}
+
+void DS18B20Bus::write(uint8_t value, uint8_t power __attribute__((unused))) {
+	elapse(BYTE_US);
+
+	switch (command_) {
+	case Command::NONE:
+		position_ = 0;
+
+		switch (value) {
+		case 0x44:
+			command_ = Command::CONVERT;
+			for (auto &sensor : sensors_) {
+				if (selected(sensor)) {
+					convert(sensor);
+				}
+			}
+			break;
+
+		case 0x4E:
+			command_ = Command::WRITE_SCRATCHPAD;
+			break;
+
+		case 0xBE:
+			command_ = Command::READ_SCRATCHPAD;
+			break;
+
+		case 0xB4:
+			command_ = Command::READ_POWER_SUPPLY;
+			break;
+		}
+		break;
+
+	case Command::WRITE_SCRATCHPAD:
+		if (position_ < 3) {
+			for (auto &sensor : sensors_) {
+				if (selected(sensor)) {
+					sensor.scratchpad[2 + position_] = position_ == 2 ? (value | 0x1F) : value;
+					update_scratchpad(sensor);
+				}
+			}
+			position_++;
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+/* Devices hold the bus low until their conversion is complete */
+uint8_t DS18B20Bus::read_bit() {
+	elapse(SLOT_US);
+
+	if (command_ == Command::CONVERT) {
+		for (auto &sensor : sensors_) {
+			if (selected(sensor) && clock_elapsed_us() < sensor.conversion_end_us) {
+				return 0;
+			}
+		}
+	}
+	return 1;
+}
+
+void DS18B20Bus::read_bytes(uint8_t *buf, uint16_t count) {
+	elapse(count * BYTE_US);
+	std::fill(buf, buf + count, 0xFF);
+
+	if (command_ != Command::READ_SCRATCHPAD) {
+		return;
+	}
+
+	for (auto &sensor : sensors_) {
+		if (!selected(sensor)) {
+			continue;
+		}
+
+		if (clock_elapsed_us() >= sensor.conversion_end_us) {
+			update_scratchpad(sensor);
+		}
+
+		for (uint16_t i = 0; i < count && position_ + i < sensor.scratchpad.size(); i++) {
+			buf[i] &= sensor.scratchpad[position_ + i];
+		}
+
+		if (position_ == 0) {
+			scratchpad_reads_++;
+
+			if (corrupt_interval_ != 0 && scratchpad_reads_ % corrupt_interval_ == 0) {
+				buf[count - 1] ^= 0x01;
+				corrupted_reads_++;
+			}
+		}
+	}
+
+	position_ += count;
+}
+
+void DS18B20Bus::depower() {
+}
+
+void DS18B20Bus::reset_search() {
+	search_ = 0;
+}
+
+bool DS18B20Bus::search(uint8_t *addr) {
+	elapse(64 * 3 * SLOT_US);
+
+	while (search_ < sensors_.size()) {
+		const Sensor &sensor = sensors_[search_++];
+
+		if (sensor.present) {
+			std::copy(sensor.address.begin(), sensor.address.end(), addr);
+			return true;
+		}
+	}
+
+	search_ = 0;
+	return false;
+}
+
+} // namespace host
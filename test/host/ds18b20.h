@@ -0,0 +1,104 @@
+/*
+ * fridge - Fridge Controller
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <OneWire.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace host {
+
+/**
+ * Emulated bus of DS18B20 temperature sensors.
+ *
+ * Operations take about as long as they would on a real bus. Sensors can be
+ * removed from the bus (they stop responding and read as all ones) and
+ * scratchpad reads can be corrupted to exercise the error handling.
+ */
+class DS18B20Bus: public OneWireBus {
+public:
+	struct Sensor {
+		std::array<uint8_t,8> address{};
+		double temperature_c = 20;
+		bool present = true;
+		std::array<uint8_t,9> scratchpad{};
+		uint64_t conversion_end_us = 0;
+		int converted_raw = 0x0550; /* 85°C at power on */
+	};
+
+	DS18B20Bus() = default;
+	~DS18B20Bus() = default;
+
+	size_t add(uint64_t serial);
+	Sensor &sensor(size_t index);
+	size_t size() const;
+
+	/* Corrupt one in every N scratchpad reads (0 to disable) */
+	void corrupt_reads(unsigned long interval);
+
+	unsigned long operations() const;
+	unsigned long conversions() const;
+	unsigned long scratchpad_reads() const;
+	unsigned long corrupted_reads() const;
+
+	uint8_t reset() override;
+	void select(const uint8_t rom[8]) override;
+	void skip() override;
+	void write(uint8_t value, uint8_t power) override;
+	uint8_t read_bit() override;
+	void read_bytes(uint8_t *buf, uint16_t count) override;
+	void depower() override;
+	void reset_search() override;
+	bool search(uint8_t *addr) override;
+
+private:
+	static constexpr uint64_t SLOT_US = 70;
+	static constexpr uint64_t RESET_US = 960;
+	static constexpr uint64_t BYTE_US = 8 * SLOT_US;
+
+	enum class Command : uint8_t {
+		NONE,
+		READ_SCRATCHPAD,
+		WRITE_SCRATCHPAD,
+		READ_POWER_SUPPLY,
+		CONVERT,
+	};
+
+	void elapse(uint64_t us);
+	bool selected(const Sensor &sensor) const;
+	void convert(Sensor &sensor);
+	void update_scratchpad(Sensor &sensor);
+
+	std::vector<Sensor> sensors_;
+	bool all_ = false;
+	std::array<uint8_t,8> rom_{};
+	Command command_ = Command::NONE;
+	size_t position_ = 0;
+	size_t search_ = 0;
+	unsigned long corrupt_interval_ = 0;
+	unsigned long operations_ = 0;
+	unsigned long conversions_ = 0;
+	unsigned long scratchpad_reads_ = 0;
+	unsigned long corrupted_reads_ = 0;
+};
+
+} // namespace host
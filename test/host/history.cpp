@@ -0,0 +1,164 @@
+/*
+ * fridge - Fridge Controller
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Records a history of emulated readings, exports it and writes the samples
+ * that tools/history-export.py should decode from the export, so that the
+ * two can be compared.
+ *
+ * The history buffer has already wrapped when the export starts, and more
+ * samples are recorded after the header has been output so that the oldest
+ * samples are overwritten during the export.
+ *
+ * Usage: history export.txt expected.csv expected.log
+ */
+
+#include <Arduino.h>
+
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+
+#include <uuid/log.h>
+
+#include "fridge/history.h"
+#include "fridge/history_export.h"
+#include "fridge/sensors.h"
+
+using fridge::History;
+using fridge::HistoryExport;
+using fridge::Sensors;
+
+static constexpr unsigned long RECORD_MINUTES = 2500;
+static constexpr unsigned long OVERWRITE_MINUTES = 10;
+
+namespace {
+
+struct Expected {
+	uint32_t uptime_s;
+	uint64_t id;
+	int16_t temperature;
+};
+
+} // namespace
+
+static Sensors::Devices devices;
+static History history;
+static std::map<uint32_t,Expected> samples;
+static unsigned long minute = 0;
+
+/*
+ * Readings vary by small amounts with occasional large steps, and one of
+ * the sensors sometimes has no reading.
+ */
+static void record(unsigned long minutes) {
+	static const float base_c[] = { 4.0f, -18.0f, 85.0f };
+
+	for (unsigned long end = minute + minutes; minute < end; minute++) {
+		uint32_t sequence = history.next();
+
+		for (size_t i = 0; i < devices.size(); i++) {
+			auto &device = devices[i];
+
+			device.temperature_c_ = base_c[i] + (int)((minute * 7 + i * 3) % 17 - 8) / 16.0f
+				+ (minute % 97 == 0 ? -20.0f : 0.0f);
+			if (i == 2 && minute % 5 == 0) {
+				device.temperature_c_ = NAN;
+			}
+		}
+
+		history.loop(devices);
+
+		for (auto &device : devices) {
+			if (!std::isnan(device.temperature_c_)) {
+				samples[sequence++] = { uuid::get_uptime_sec(), device.id(),
+					(int16_t)std::lround(device.temperature_c_ * 16) };
+			}
+		}
+
+		delay(History::SAMPLE_INTERVAL_MS);
+	}
+}
+
+int main(int argc, char *argv[]) {
+	if (argc != 4) {
+		fprintf(stderr, "Usage: %s export.txt expected.csv expected.log\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	FILE *export_file = fopen(argv[1], "w");
+	FILE *csv_file = fopen(argv[2], "w");
+	FILE *log_file = fopen(argv[3], "w");
+
+	if (!export_file || !csv_file || !log_file) {
+		perror("fopen");
+		return EXIT_FAILURE;
+	}
+
+	uuid::log::Logger::level(uuid::log::Level::WARNING);
+	host::clock_start(ULONG_MAX - 10 * 60 * 1000);
+
+	devices.emplace_back(0x2800000000001234ULL);
+	devices.emplace_back(0x28FFEEDDCCBBAA99ULL);
+	devices.emplace_back(0x2801020304050607ULL);
+
+	history.start();
+	record(RECORD_MINUTES);
+
+	if (history.first() == 0) {
+		fprintf(stderr, "History buffer has not wrapped\n");
+		return EXIT_FAILURE;
+	}
+
+	HistoryExport history_export;
+	uint32_t first = history.first();
+	uint32_t end = history.next();
+	const char *line;
+
+	history_export.begin(history);
+	fprintf(export_file, "-----BEGIN FRIDGE HISTORY-----\n");
+	fprintf(export_file, "%s\n", history_export.next(history));
+
+	record(OVERWRITE_MINUTES);
+
+	uint32_t lost = history.first() - first;
+
+	while ((line = history_export.next(history)) != nullptr) {
+		fprintf(export_file, "%s\n", line);
+	}
+	fprintf(export_file, "-----END FRIDGE HISTORY-----\n");
+
+	fprintf(csv_file, "uptime_s,sensor,temperature_c\n");
+	for (uint32_t sequence = first + lost; sequence != end; sequence++) {
+		const Expected &sample = samples[sequence];
+
+		fprintf(csv_file, "%u,%s,%.4f\n", sample.uptime_s,
+			Sensors::Device(sample.id).to_string().c_str(), sample.temperature / 16.0);
+	}
+
+	fprintf(log_file, "%u samples exported, %u overwritten during export\n", end - first - lost, lost);
+
+	fclose(export_file);
+	fclose(csv_file);
+	fclose(log_file);
+
+	printf("Exported %u samples, %u overwritten during export\n", end - first - lost, lost);
+	return lost > 0 && lost < end - first ? EXIT_SUCCESS : EXIT_FAILURE;
+}
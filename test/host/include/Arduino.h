@@ -0,0 +1,84 @@
+/*
+ * fridge - Fridge Controller
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Minimal Arduino API for building parts of the application on the host.
+ *
+ * Time only advances when the test advances it, and the clock can be
+ * started anywhere (e.g. just before millis() wraps).
+ *
+ * The application relies on unsigned long arithmetic to handle the wrap of
+ * millis() and micros(), which is 32 bits on the ESP32 but usually 64 bits
+ * on the host. The clock wraps at the width of unsigned long so that the
+ * same code paths are used; starting it just before the end of the range
+ * wraps the low 32 bits at the same time, so anything that truncates a time
+ * to 32 bits is still tested.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+class __FlashStringHelper;
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(s))
+#define FPSTR(p) (reinterpret_cast<const __FlashStringHelper *>(p))
+#define snprintf_P snprintf
+#define vsnprintf_P vsnprintf
+#define strlen_P strlen
+#define strncmp_P strncmp
+#define memcpy_P memcpy
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+
+#define RTC_NOINIT_ATTR
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+void pinMode(int pin, int mode);
+void digitalWrite(int pin, int value);
+int digitalRead(int pin);
+
+namespace host {
+
+/* Start the clock so that millis() returns this value */
+void clock_start(unsigned long millis);
+void clock_advance_us(uint64_t us);
+uint64_t clock_elapsed_us();
+
+int pin_value(int pin);
+void pin_input(int pin, int value);
+
+} // namespace host
@@ -0,0 +1,39 @@
+/*
+ * fridge - Fridge Controller
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * An IPv4 address in network byte order, as on the device.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+class IPAddress {
+public:
+	IPAddress() = default;
+	IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+		: address_((uint32_t)a | ((uint32_t)b << 8) | ((uint32_t)c << 16) | ((uint32_t)d << 24)) {}
+	IPAddress(uint32_t address) : address_(address) {}
+	~IPAddress() = default;
+
+	operator uint32_t() const { return address_; }
+	uint8_t operator[](int index) const { return address_ >> (8 * index); }
+
+private:
+	uint32_t address_ = 0;
+};
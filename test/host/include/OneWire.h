@@ -0,0 +1,67 @@
+/*
+ * fridge - Fridge Controller
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * OneWire API that forwards every operation to a bus implementation
+ * provided by the test, so that the same build can talk to emulated
+ * devices or replay a recorded trace.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace host {
+
+class OneWireBus {
+public:
+	virtual ~OneWireBus() = default;
+
+	virtual uint8_t reset() = 0;
+	virtual void select(const uint8_t rom[8]) = 0;
+	virtual void skip() = 0;
+	virtual void write(uint8_t value, uint8_t power) = 0;
+	virtual uint8_t read_bit() = 0;
+	virtual void read_bytes(uint8_t *buf, uint16_t count) = 0;
+	virtual void depower() = 0;
+	virtual void reset_search() = 0;
+	virtual bool search(uint8_t *addr) = 0;
+};
+
+void onewire_attach(OneWireBus *bus);
+
+} // namespace host
+
+class OneWire {
+public:
+	OneWire() = default;
+	~OneWire() = default;
+
+	void begin(uint8_t pin);
+	uint8_t reset();
+	void select(const uint8_t rom[8]);
+	void skip();
+	void write(uint8_t value, uint8_t power = 0);
+	uint8_t read_bit();
+	void read_bytes(uint8_t *buf, uint16_t count);
+	void depower();
+	void reset_search();
+	bool search(uint8_t *addr, bool search_mode = true);
+
+	static uint8_t crc8(const uint8_t *addr, uint8_t len);
+};
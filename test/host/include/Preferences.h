@@ -0,0 +1,46 @@
+/*
+ * fridge - Fridge Controller
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Preferences kept in memory for the lifetime of the process, so that they
+ * survive the modules that use them being recreated.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class Preferences {
+public:
+	Preferences() = default;
+	~Preferences() = default;
+
+	bool begin(const char *name, bool read_only = false, const char *partition_label = nullptr);
+	void end();
+
+	bool isKey(const char *key);
+	size_t putULong(const char *key, uint32_t value);
+	size_t putULong64(const char *key, uint64_t value);
+	uint32_t getULong(const char *key, uint32_t default_value = 0);
+	uint64_t getULong64(const char *key, uint64_t default_value = 0);
+
+private:
+	std::string name_;
+};
@@ -0,0 +1,43 @@
+/*
+ * fridge - Fridge Controller
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * Network connection of the current node. Several simulated controllers
+ * share it, so the test selects the node before running each one.
+ */
+
+#pragma once
+
+#include <IPAddress.h>
+
+class WiFiClass {
+public:
+	WiFiClass() = default;
+	~WiFiClass() = default;
+
+	bool isConnected();
+	IPAddress localIP();
+};
+
+extern WiFiClass WiFi;
+
+namespace host {
+
+/* Connect as this address, or disconnect if it is zero */
+void wifi_local_ip(IPAddress address);
+
+} // namespace host
@@ -0,0 +1,81 @@
+/*
+ * fridge - Fridge Controller
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * UDP multicast looped back between the sockets in this process. A frame
+ * sent to a group is queued on every socket that has joined it (including
+ * the sender, as on the device) with the local address of the sender.
+ */
+
+#pragma once
+
+#include <IPAddress.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace host {
+
+/* Discard the next frames sent to any group */
+void udp_drop(unsigned int count);
+
+/* Send a frame to a group from another address */
+void udp_send(IPAddress group, uint16_t port, IPAddress remote, const uint8_t *data, size_t len);
+
+} // namespace host
+
+class WiFiUDP {
+public:
+	WiFiUDP() = default;
+	~WiFiUDP();
+	WiFiUDP(const WiFiUDP&) = delete;
+	WiFiUDP& operator=(const WiFiUDP&) = delete;
+
+	uint8_t beginMulticast(IPAddress address, uint16_t port);
+	void stop();
+
+	int parsePacket();
+	IPAddress remoteIP();
+	int read(uint8_t *buffer, size_t len);
+	void flush();
+
+	int beginMulticastPacket();
+	size_t write(const uint8_t *buffer, size_t size);
+	int endPacket();
+
+private:
+	struct Packet {
+		IPAddress remote;
+		std::vector<uint8_t> data;
+	};
+
+	static constexpr size_t MAX_QUEUED = 16;
+
+	friend void host::udp_send(IPAddress group, uint16_t port, IPAddress remote, const uint8_t *data, size_t len);
+
+	static void deliver(IPAddress group, uint16_t port, IPAddress remote, const std::vector<uint8_t> &data);
+
+	bool joined_ = false;
+	IPAddress group_;
+	uint16_t port_ = 0;
+	std::deque<Packet> queue_;
+	Packet current_;
+	size_t position_ = 0;
+	std::vector<uint8_t> sending_;
+};
@@ -0,0 +1,46 @@
+/*
+ * fridge - Fridge Controller
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Configuration with the default values and no storage. The getters and
+ * static members are defined in app_config.cpp, the setters are the
+ * application's own. The hostname can be changed to simulate several
+ * controllers.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include <string>
+
+namespace app {
+
+class Config {
+public:
+	Config() = default;
+	~Config() = default;
+
+	void commit();
+	std::string hostname() const;
+	void hostname(const std::string &hostname);
+
+#include "config_class.h"
+};
+
+} // namespace app
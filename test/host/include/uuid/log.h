@@ -0,0 +1,90 @@
+/*
+ * fridge - Fridge Controller
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+#include <uuid/common.h>
+
+namespace uuid {
+
+namespace log {
+
+enum class Level : int8_t {
+	OFF = -1,
+	EMERG = 0,
+	ALERT,
+	CRIT,
+	ERR,
+	WARNING,
+	NOTICE,
+	INFO,
+	DEBUG,
+	TRACE,
+	ALL,
+};
+
+enum class Facility : uint8_t {
+	KERN = 0,
+	USER,
+	MAIL,
+	DAEMON,
+};
+
+/*
+ * Messages at or above the configured level are written to stderr and every
+ * message is counted by level so that tests can check for errors.
+ */
+class Logger {
+public:
+	Logger(const __FlashStringHelper *name, Facility facility = Facility::USER);
+
+	static void level(Level level);
+	static unsigned long count(Level level);
+
+	void emerg(const __FlashStringHelper *format, ...) const;
+	void alert(const __FlashStringHelper *format, ...) const;
+	void crit(const __FlashStringHelper *format, ...) const;
+	void err(const __FlashStringHelper *format, ...) const;
+	void warning(const __FlashStringHelper *format, ...) const;
+	void notice(const __FlashStringHelper *format, ...) const;
+	void info(const __FlashStringHelper *format, ...) const;
+	void debug(const __FlashStringHelper *format, ...) const;
+	void trace(const __FlashStringHelper *format, ...) const;
+
+	bool enabled(Level level) const;
+
+private:
+	void vlog(Level level, const __FlashStringHelper *format, va_list ap) const;
+
+	static Level level_;
+	static std::array<unsigned long,10> counts_;
+
+	const char *name_;
+};
+
+std::string format_timestamp_ms(uint64_t timestamp_ms, unsigned int days_width = 1);
+
+} // namespace log
+
+} // namespace uuid
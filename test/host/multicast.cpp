@@ -0,0 +1,275 @@
+/*
+ * fridge - Fridge Controller
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Runs several multicast instances against each other, as simulated
+ * controllers on different addresses, over UDP looped back within the
+ * process. Each one must find the others with their status, count frames
+ * that are dropped or invalid and forget controllers that stop sending.
+ *
+ * The clock starts just before millis() wraps.
+ */
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+
+#include <array>
+#include <climits>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <uuid/log.h>
+
+#include "app/config.h"
+#include "fridge/multicast.h"
+#include "fridge/sensors.h"
+
+using fridge::Multicast;
+using fridge::Sensors;
+
+static constexpr size_t NODES = 3;
+static constexpr size_t SENSORS = 3;
+static constexpr unsigned int DROPPED = 3;
+static constexpr unsigned long LOOP_INTERVAL_MS = 100;
+static constexpr unsigned long SEND_INTERVAL_MS = 10 * 1000; /* Multicast::SEND_INTERVAL_MS */
+static constexpr unsigned long PEER_TIMEOUT_MS = 6 * SEND_INTERVAL_MS; /* Multicast::PEER_TIMEOUT_MS */
+static constexpr size_t FRAME_LEN = 112; /* Multicast::FRAME_LEN */
+
+namespace {
+
+struct Node {
+	std::string hostname;
+	IPAddress address;
+	uint8_t flags = 0;
+	Sensors::Devices devices;
+	Multicast multicast;
+	bool running = true;
+};
+
+} // namespace
+
+static std::array<Node,NODES> nodes;
+static bool ok = true;
+
+static bool check(bool condition, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+static bool check(bool condition, const char *format, ...) {
+	if (!condition) {
+		va_list ap;
+
+		printf("FAIL: ");
+		va_start(ap, format);
+		vprintf(format, ap);
+		va_end(ap);
+		printf("\n");
+		ok = false;
+	}
+	return condition;
+}
+
+static void run(unsigned long duration_ms) {
+	for (unsigned long elapsed_ms = 0; elapsed_ms < duration_ms; elapsed_ms += LOOP_INTERVAL_MS) {
+		for (auto &node : nodes) {
+			if (node.running) {
+				host::wifi_local_ip(node.address);
+				node.multicast.loop(node.devices, node.flags);
+			}
+		}
+
+		host::clock_advance_us(LOOP_INTERVAL_MS * 1000);
+	}
+
+	host::wifi_local_ip(0U);
+}
+
+static const Multicast::Peer *find_peer(const Node &node, const Node &other) {
+	for (auto &peer : node.multicast.peers()) {
+		if (peer.address != 0 && std::strcmp(peer.hostname, other.hostname.c_str()) == 0) {
+			return &peer;
+		}
+	}
+
+	return nullptr;
+}
+
+static size_t peer_count(const Node &node) {
+	size_t count = 0;
+
+	for (auto &peer : node.multicast.peers()) {
+		if (peer.address != 0) {
+			count++;
+		}
+	}
+	return count;
+}
+
+static unsigned long lost_count(const Node &node) {
+	unsigned long lost = 0;
+
+	for (auto &peer : node.multicast.peers()) {
+		lost += peer.lost;
+	}
+	return lost;
+}
+
+static void check_peer(const Node &node, const Node &other) {
+	const Multicast::Peer *peer = find_peer(node, other);
+
+	if (!check(peer != nullptr, "%s: %s not found", node.hostname.c_str(), other.hostname.c_str())) {
+		return;
+	}
+
+	check(peer->address == (uint32_t)other.address, "%s: %s has the wrong address",
+		node.hostname.c_str(), other.hostname.c_str());
+	check(peer->flags == other.flags, "%s: %s has flags %02x, expected %02x",
+		node.hostname.c_str(), other.hostname.c_str(), peer->flags, other.flags);
+	check(peer->sensor_count == other.devices.size(), "%s: %s has %u sensors, expected %zu",
+		node.hostname.c_str(), other.hostname.c_str(), peer->sensor_count, other.devices.size());
+
+	for (size_t i = 0; i < other.devices.size(); i++) {
+		const auto &device = other.devices[i];
+		int16_t temperature = std::isnan(device.temperature_c_)
+			? Multicast::UNKNOWN_TEMPERATURE : std::lround(device.temperature_c_ * 16);
+
+		check(peer->ids[i] == device.id(), "%s: %s sensor %zu has the wrong address",
+			node.hostname.c_str(), other.hostname.c_str(), i);
+		check(peer->temperatures[i] == temperature, "%s: %s sensor %zu temperature %d, expected %d",
+			node.hostname.c_str(), other.hostname.c_str(), i, peer->temperatures[i], temperature);
+	}
+}
+
+static void check_peers(const char *stage) {
+	for (auto &node : nodes) {
+		check(peer_count(node) == NODES - 1, "%s: %s has %zu peers, expected %zu",
+			stage, node.hostname.c_str(), peer_count(node), NODES - 1);
+		check(std::strcmp(node.multicast.self().hostname, node.hostname.c_str()) == 0,
+			"%s: %s has the wrong hostname for itself", stage, node.hostname.c_str());
+
+		for (auto &other : nodes) {
+			if (&other != &node) {
+				check_peer(node, other);
+			}
+		}
+	}
+}
+
+static void report() {
+	printf("%-10s %6s %9s %8s %5s %5s\n", "Node", "Sent", "Received", "Invalid", "Lost", "Peers");
+
+	for (auto &node : nodes) {
+		printf("%-10s %6lu %9lu %8lu %5lu %5zu\n", node.hostname.c_str(), node.multicast.sent(),
+			node.multicast.received(), node.multicast.invalid(), lost_count(node), peer_count(node));
+	}
+
+	printf("\n");
+}
+
+int main() {
+	uuid::log::Logger::level(uuid::log::Level::WARNING);
+	host::clock_start(ULONG_MAX - 60 * 1000);
+
+	app::Config config;
+
+	config.multicast_status(true);
+
+	for (size_t i = 0; i < NODES; i++) {
+		auto &node = nodes[i];
+
+		node.hostname = "fridge" + std::to_string(i + 1);
+		node.address = IPAddress(192, 168, 0, i + 1);
+		node.flags = Multicast::FLAG_RELAY_AUTO | (i == 0 ? Multicast::FLAG_RELAY : 0);
+
+		for (size_t j = 0; j < SENSORS; j++) {
+			node.devices.emplace_back(0x28000000000000ULL | (i + 1) << 8 | j);
+			/* One sensor without a reading */
+			node.devices.back().temperature_c_ = j == SENSORS - 1 ? NAN : 2.5f + i - j * 3.0625f;
+		}
+
+		config.hostname(node.hostname);
+		node.multicast.start();
+		check(node.multicast.enabled(), "%s: not enabled", node.hostname.c_str());
+	}
+
+	/* The first node sends before the others have joined */
+	run(3 * SEND_INTERVAL_MS);
+	check_peers("start");
+	for (auto &node : nodes) {
+		check(node.multicast.active(), "%s: not active", node.hostname.c_str());
+		check(lost_count(node) == 0, "%s: %lu frames lost", node.hostname.c_str(), lost_count(node));
+	}
+
+	/* Every frame that is dropped is missed by all of the other nodes */
+	host::udp_drop(DROPPED);
+	run(3 * SEND_INTERVAL_MS);
+	check_peers("dropped frames");
+	unsigned long lost = 0;
+	for (auto &node : nodes) {
+		lost += lost_count(node);
+	}
+	check(lost == DROPPED * (NODES - 1), "%lu frames lost, expected %zu", lost, DROPPED * (NODES - 1));
+
+	std::array<uint8_t,FRAME_LEN / 2> short_frame{};
+	std::array<uint8_t,FRAME_LEN> unknown_frame{};
+
+	host::udp_send(Multicast::group(), Multicast::PORT, IPAddress(192, 168, 0, 100),
+		short_frame.data(), short_frame.size());
+	host::udp_send(Multicast::group(), Multicast::PORT, IPAddress(192, 168, 0, 100),
+		unknown_frame.data(), unknown_frame.size());
+	run(LOOP_INTERVAL_MS);
+	check_peers("invalid frames");
+	for (auto &node : nodes) {
+		check(node.multicast.invalid() == 2, "%s: %lu invalid frames, expected 2",
+			node.hostname.c_str(), node.multicast.invalid());
+	}
+
+	/* The last node stops sending, so the others must forget it */
+	auto &stopped = nodes[NODES - 1];
+
+	stopped.running = false;
+	run(PEER_TIMEOUT_MS - 2 * SEND_INTERVAL_MS);
+	for (auto &node : nodes) {
+		if (&node != &stopped) {
+			check(find_peer(node, stopped) != nullptr, "%s: %s expired too soon",
+				node.hostname.c_str(), stopped.hostname.c_str());
+		}
+	}
+
+	run(2 * SEND_INTERVAL_MS + LOOP_INTERVAL_MS);
+	for (auto &node : nodes) {
+		if (&node != &stopped) {
+			check(find_peer(node, stopped) == nullptr, "%s: %s not expired",
+				node.hostname.c_str(), stopped.hostname.c_str());
+			check(peer_count(node) == NODES - 2, "%s: %zu peers, expected %zu",
+				node.hostname.c_str(), peer_count(node), NODES - 2);
+		}
+	}
+
+	/* It is found again when it resumes */
+	stopped.running = true;
+	run(2 * SEND_INTERVAL_MS);
+	check_peers("resumed");
+
+	report();
+	printf("%s\n", ok ? "PASS" : "FAIL");
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
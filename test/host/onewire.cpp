@@ -0,0 +1,91 @@
+/*
+ * fridge - Fridge Controller
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <OneWire.h>
+
+#include <cstdint>
+
+static host::OneWireBus *attached = nullptr;
+
+namespace host {
+
+void onewire_attach(OneWireBus *bus) {
+	attached = bus;
+}
+
+} // namespace host
+
+void OneWire::begin(uint8_t pin __attribute__((unused))) {
+}
+
+uint8_t OneWire::reset() {
+	return attached->reset();
+}
+
+void OneWire::select(const uint8_t rom[8]) {
+	attached->select(rom);
+}
+
+void OneWire::skip() {
+	attached->skip();
+}
+
+void OneWire::write(uint8_t value, uint8_t power) {
+	attached->write(value, power);
+}
+
+uint8_t OneWire::read_bit() {
+	return attached->read_bit();
+}
+
+void OneWire::read_bytes(uint8_t *buf, uint16_t count) {
+	attached->read_bytes(buf, count);
+}
+
+void OneWire::depower() {
+	attached->depower();
+}
+
+void OneWire::reset_search() {
+	attached->reset_search();
+}
+
+bool OneWire::search(uint8_t *addr, bool search_mode __attribute__((unused))) {
+	return attached->search(addr);
+}
+
+/* Dallas/Maxim CRC-8 (x^8 + x^5 + x^4 + 1) */
+uint8_t OneWire::crc8(const uint8_t *addr, uint8_t len) {
+	uint8_t crc = 0;
+
+	while (len--) {
+		uint8_t value = *addr++;
+
+		for (int i = 0; i < 8; i++) {
+			uint8_t mix = (crc ^ value) & 0x01;
+
+			crc >>= 1;
+			if (mix) {
+				crc ^= 0x8C;
+			}
+			value >>= 1;
+		}
+	}
+
+	return crc;
+}
@@ -0,0 +1,56 @@
+/*
+ * fridge - Fridge Controller
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Preferences.h>
+
+#include <map>
+#include <string>
+
+static std::map<std::string,std::map<std::string,uint64_t>> storage;
+
+bool Preferences::begin(const char *name, bool read_only __attribute__((unused)),
+		const char *partition_label __attribute__((unused))) {
+	name_ = name;
+	return true;
+}
+
+void Preferences::end() {
+	name_.clear();
+}
+
+bool Preferences::isKey(const char *key) {
+	return storage[name_].count(key) > 0;
+}
+
+size_t Preferences::putULong(const char *key, uint32_t value) {
+	storage[name_][key] = value;
+	return sizeof(value);
+}
+
+size_t Preferences::putULong64(const char *key, uint64_t value) {
+	storage[name_][key] = value;
+	return sizeof(value);
+}
+
+uint32_t Preferences::getULong(const char *key, uint32_t default_value) {
+	return isKey(key) ? storage[name_][key] : default_value;
+}
+
+uint64_t Preferences::getULong64(const char *key, uint64_t default_value) {
+	return isKey(key) ? storage[name_][key] : default_value;
+}
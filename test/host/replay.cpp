@@ -0,0 +1,548 @@
+/*
+ * fridge - Fridge Controller
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Replays a bus trace recorded by a controller through the sensor engine
+ * and reports throughput, latency and allocations, so that changes can be
+ * judged against the behaviour of a real bus.
+ *
+ * The devices, the scratchpad contents read from each of them, the
+ * conversion times and the duration of each type of operation are taken
+ * from the trace. Responses are served to the engine by device rather than
+ * in strict order so that the replay isn't derailed when the engine does
+ * something different (e.g. with short reads enabled).
+ *
+ * Usage: replay [-r repeat] [-i interval_ms] [-s] trace.bin
+ *        replay -g trace.txt
+ *
+ * The second form records a trace from emulated sensors in the same format
+ * as the "show trace" command.
+ */
+
+#include <Arduino.h>
+#include <OneWire.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <new>
+#include <vector>
+
+#include <unistd.h>
+
+#include <uuid/log.h>
+
+#include "app/config.h"
+#include "ds18b20.h"
+#include "fridge/bus_trace.h"
+#include "fridge/memory.h"
+#include "fridge/sensors.h"
+
+using fridge::BusTrace;
+using fridge::Memory;
+using fridge::Sensors;
+using Operation = BusTrace::Operation;
+using Address = std::array<uint8_t,8>;
+
+static bool count_allocations = false;
+static unsigned long allocations = 0;
+static unsigned long allocated_bytes = 0;
+
+/* Not inlined so that the compiler doesn't pair malloc() with delete */
+__attribute__((noinline)) void *operator new(size_t size) {
+	if (count_allocations) {
+		allocations++;
+		allocated_bytes += size;
+	}
+
+	void *ptr = std::malloc(size ? size : 1);
+
+	if (!ptr) {
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+__attribute__((noinline)) void operator delete(void *ptr) noexcept {
+	std::free(ptr);
+}
+
+__attribute__((noinline)) void operator delete(void *ptr, size_t size __attribute__((unused))) noexcept {
+	std::free(ptr);
+}
+
+struct Record {
+	Operation operation;
+	uint32_t start_us;
+	uint16_t duration_us;
+	std::vector<uint8_t> data;
+};
+
+static std::vector<Record> load(const char *filename) {
+	std::ifstream file(filename, std::ios::binary);
+	std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	std::vector<Record> records;
+	size_t offset = 0;
+
+	while (offset + BusTrace::HEADER_LEN <= data.size()) {
+		Record record;
+		size_t len = data[offset + 1];
+
+		record.operation = static_cast<Operation>(data[offset]);
+		record.start_us = data[offset + 2] | (data[offset + 3] << 8)
+			| (data[offset + 4] << 16) | ((uint32_t)data[offset + 5] << 24);
+		record.duration_us = data[offset + 6] | (data[offset + 7] << 8);
+		offset += BusTrace::HEADER_LEN;
+
+		if (offset + len > data.size()) {
+			break;
+		}
+
+		record.data.assign(&data[offset], &data[offset + len]);
+		records.push_back(record);
+		offset += len;
+	}
+
+	return records;
+}
+
+/**
+ * Bus that responds with what was recorded in a trace.
+ */
+class ReplayBus: public host::OneWireBus {
+public:
+	ReplayBus(const std::vector<Record> &records, unsigned long repeat) {
+		std::map<Operation,std::pair<uint64_t,unsigned long>> durations;
+		const Address *address = nullptr;
+		bool reading = false;
+		uint32_t convert_us = 0;
+		bool converting = false;
+		uint8_t command = 0;
+
+		for (auto &record : records) {
+			auto &duration = durations[record.operation];
+			size_t len = std::max((size_t)1, record.data.size());
+
+			switch (record.operation) {
+			case Operation::RESET:
+				presence_.push_back(record.data.empty() ? 1 : record.data[0]);
+				reading = false;
+				command = 0;
+				break;
+
+			case Operation::SELECT:
+				if (record.data.size() == 8) {
+					Address rom;
+
+					std::copy(record.data.begin(), record.data.end(), rom.begin());
+					address = &devices_.emplace(rom, Device{}).first->first;
+				}
+				break;
+
+			case Operation::SKIP:
+				address = nullptr;
+				break;
+
+			case Operation::WRITE:
+				command = command ? command : record.data.at(0);
+				reading = address && command == CMD_READ_SCRATCHPAD;
+				if (record.data.at(0) == CMD_CONVERT_TEMP && command == CMD_CONVERT_TEMP) {
+					convert_us = record.start_us;
+					converting = true;
+				}
+				break;
+
+			case Operation::READ_BIT:
+				if (command == CMD_READ_POWER_SUPPLY) {
+					power_supply_ = record.data.at(0);
+				}
+				break;
+
+			case Operation::POLL:
+				if (record.data.size() >= 7) {
+					unsigned long polls = record.data[0] | (record.data[1] << 8);
+					unsigned long poll_us = record.data[3] | (record.data[4] << 8)
+						| (record.data[5] << 16) | ((uint32_t)record.data[6] << 24);
+
+					durations[Operation::READ_BIT].first += poll_us;
+					durations[Operation::READ_BIT].second += polls;
+
+					if (converting && record.data[2] == 1) {
+						conversions_us_.push_back(record.start_us + record.duration_us - convert_us);
+					}
+				}
+				converting = false;
+				continue;
+
+			case Operation::READ_BYTES:
+				if (reading) {
+					devices_[*address].reads.push_back(record.data);
+					recorded_reads_++;
+				}
+				reading = false;
+				break;
+
+			case Operation::SEARCH:
+				if (record.data.size() == 9 && record.data[0]) {
+					Address rom;
+
+					std::copy(record.data.begin() + 1, record.data.end(), rom.begin());
+					devices_.emplace(rom, Device{});
+				}
+				break;
+
+			case Operation::CYCLE:
+				recorded_cycles_++;
+				continue;
+
+			default:
+				break;
+			}
+
+			duration.first += record.duration_us / len;
+			duration.second++;
+		}
+
+		for (auto &duration : durations) {
+			if (duration.second.second) {
+				duration_us_[duration.first] = duration.second.first / duration.second.second;
+			}
+		}
+
+		if (presence_.empty()) {
+			presence_.push_back(1);
+		}
+
+		target_reads_ = recorded_reads_ * repeat;
+	}
+
+	size_t devices() const { return devices_.size(); }
+	unsigned long recorded_reads() const { return recorded_reads_; }
+	unsigned long recorded_cycles() const { return recorded_cycles_; }
+	size_t recorded_conversions() const { return conversions_us_.size(); }
+	unsigned long operations() const { return operations_; }
+	unsigned long reads() const { return reads_; }
+	bool done() const { return reads_ >= target_reads_; }
+
+	uint8_t reset() override {
+		elapse(Operation::RESET);
+		selected_ = nullptr;
+		command_ = 0;
+		return presence_[presence_index_++ % presence_.size()];
+	}
+
+	void select(const uint8_t rom[8]) override {
+		Address address;
+
+		elapse(Operation::SELECT);
+		std::copy(rom, rom + 8, address.begin());
+
+		auto it = devices_.find(address);
+
+		selected_ = it != devices_.end() ? &it->second : nullptr;
+	}
+
+	void skip() override {
+		elapse(Operation::SKIP);
+	}
+
+	void write(uint8_t value, uint8_t power __attribute__((unused))) override {
+		elapse(Operation::WRITE);
+
+		if (command_ == 0) {
+			command_ = value;
+
+			if (value == CMD_CONVERT_TEMP) {
+				uint64_t conversion_us = conversions_us_.empty() ? 750000
+					: conversions_us_[conversion_index_++ % conversions_us_.size()];
+
+				conversion_end_us_ = host::clock_elapsed_us() + conversion_us;
+			}
+		}
+	}
+
+	uint8_t read_bit() override {
+		elapse(Operation::READ_BIT);
+
+		if (command_ == CMD_CONVERT_TEMP) {
+			return host::clock_elapsed_us() >= conversion_end_us_ ? 1 : 0;
+		} else if (command_ == CMD_READ_POWER_SUPPLY) {
+			return power_supply_;
+		}
+		return 1;
+	}
+
+	/*
+	 * Short reads in the trace are expanded using the rest of the last full
+	 * read from the same device so that a full read can still be served.
+	 */
+	void read_bytes(uint8_t *buf, uint16_t count) override {
+		elapse(Operation::READ_BYTES, count);
+		std::fill(buf, buf + count, 0xFF);
+
+		if (command_ != CMD_READ_SCRATCHPAD || !selected_ || selected_->reads.empty()) {
+			return;
+		}
+
+		Device &device = *selected_;
+		const auto &read = device.reads[device.index++ % device.reads.size()];
+
+		if (read.size() == device.full.size()) {
+			std::copy(read.begin(), read.end(), device.full.begin());
+			device.valid = true;
+		} else if (device.valid && read.size() >= 2) {
+			device.full[0] = read[0];
+			device.full[1] = read[1];
+			device.full[8] = OneWire::crc8(device.full.data(), 8);
+		}
+
+		if (count <= read.size()) {
+			std::copy(read.begin(), read.begin() + count, buf);
+		} else if (device.valid) {
+			std::copy(device.full.begin(), device.full.begin() + std::min((size_t)count, device.full.size()), buf);
+		}
+
+		reads_++;
+		command_ = 0;
+	}
+
+	void depower() override {
+	}
+
+	void reset_search() override {
+		elapse(Operation::RESET_SEARCH);
+		search_ = devices_.begin();
+	}
+
+	bool search(uint8_t *addr) override {
+		elapse(Operation::SEARCH);
+
+		if (search_ == devices_.end()) {
+			return false;
+		}
+
+		std::copy(search_->first.begin(), search_->first.end(), addr);
+		++search_;
+		return true;
+	}
+
+private:
+	static constexpr uint8_t CMD_CONVERT_TEMP = 0x44;
+	static constexpr uint8_t CMD_READ_SCRATCHPAD = 0xBE;
+	static constexpr uint8_t CMD_READ_POWER_SUPPLY = 0xB4;
+
+	struct Device {
+		std::vector<std::vector<uint8_t>> reads;
+		size_t index = 0;
+		std::array<uint8_t,9> full{};
+		bool valid = false;
+	};
+
+	void elapse(Operation operation, size_t len = 1) {
+		operations_++;
+		host::clock_advance_us(duration_us_[operation] * len);
+	}
+
+	std::map<Address,Device> devices_;
+	std::map<Address,Device>::iterator search_ = devices_.end();
+	std::map<Operation,uint64_t> duration_us_;
+	std::vector<uint8_t> presence_;
+	size_t presence_index_ = 0;
+	std::vector<uint64_t> conversions_us_;
+	size_t conversion_index_ = 0;
+	uint8_t power_supply_ = 1;
+	unsigned long recorded_reads_ = 0;
+	unsigned long recorded_cycles_ = 0;
+	unsigned long target_reads_ = 0;
+	unsigned long reads_ = 0;
+	unsigned long operations_ = 0;
+
+	Device *selected_ = nullptr;
+	uint8_t command_ = 0;
+	uint64_t conversion_end_us_ = 0;
+};
+
+static int usage(const char *name) {
+	fprintf(stderr, "Usage: %s [-r repeat] [-i interval_ms] [-s] trace.bin\n", name);
+	fprintf(stderr, "       %s -g trace.txt\n", name);
+	return EXIT_FAILURE;
+}
+
+static void configure(unsigned long interval_ms, bool short_read) {
+	app::Config config;
+
+	config.sensors_slow_interval(interval_ms);
+	config.sensors_fast_interval(interval_ms);
+	config.sensors_short_read(short_read);
+}
+
+/*
+ * Record a trace from emulated sensors, with the temperatures changing so
+ * that both resolutions are used.
+ */
+static int generate(const char *filename) {
+	static constexpr size_t BYTES_PER_LINE = 32;
+	host::DS18B20Bus bus;
+	Sensors sensors;
+	FILE *file = fopen(filename, "w");
+
+	if (!file) {
+		perror(filename);
+		return EXIT_FAILURE;
+	}
+
+	for (uint64_t serial = 1; serial <= 4; serial++) {
+		bus.add(serial * 0x01020304);
+	}
+
+	host::onewire_attach(&bus);
+	sensors.start(0);
+	sensors.trace(true);
+
+	for (unsigned long time_ms = 0; time_ms < 10 * 60 * 1000; time_ms++) {
+		for (size_t i = 0; i < bus.size(); i++) {
+			bus.sensor(i).temperature_c = 4 + i + std::sin(time_ms / 60000.0) * 2;
+		}
+
+		sensors.loop();
+		host::clock_advance_us(1000);
+	}
+
+	std::vector<uint8_t> data(BYTES_PER_LINE);
+	size_t offset = 0;
+	size_t len;
+
+	fprintf(file, "Trace: %zu bytes, %lu records dropped\n", sensors.trace().used(), sensors.trace().dropped());
+
+	while ((len = sensors.trace().read(offset, data.data(), data.size())) > 0) {
+		for (size_t i = 0; i < len; i++) {
+			fprintf(file, "%02X", data[i]);
+		}
+		fprintf(file, "\n");
+		offset += len;
+	}
+
+	fclose(file);
+	return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+	unsigned long repeat = 100;
+	unsigned long interval_ms = 1000;
+	bool short_read = false;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "g:r:i:s")) != -1) {
+		switch (opt) {
+		case 'g':
+			return generate(optarg);
+
+		case 'r':
+			repeat = std::strtoul(optarg, nullptr, 10);
+			break;
+
+		case 'i':
+			interval_ms = std::strtoul(optarg, nullptr, 10);
+			break;
+
+		case 's':
+			short_read = true;
+			break;
+
+		default:
+			return usage(argv[0]);
+		}
+	}
+
+	if (optind + 1 != argc || repeat == 0) {
+		return usage(argv[0]);
+	}
+
+	std::vector<Record> records = load(argv[optind]);
+	ReplayBus bus{records, repeat};
+
+	if (bus.recorded_reads() == 0) {
+		fprintf(stderr, "%s: no scratchpad reads in trace\n", argv[optind]);
+		return EXIT_FAILURE;
+	}
+
+	printf("Trace: %zu records, %zu devices, %lu cycles, %lu scratchpad reads, %zu conversions\n",
+		records.size(), bus.devices(), bus.recorded_cycles(), bus.recorded_reads(),
+		bus.recorded_conversions());
+
+	configure(interval_ms, short_read);
+	host::onewire_attach(&bus);
+
+	Sensors sensors;
+	unsigned long generation = 0;
+	unsigned long cycles = 0;
+	uint64_t cycle_start_us = 0;
+	uint64_t latency_total_us = 0;
+	uint64_t latency_max_us = 0;
+	auto wall_start = std::chrono::steady_clock::now();
+
+	sensors.start(0);
+	count_allocations = true;
+
+	while (!bus.done()) {
+		Sensors::State state = sensors.state();
+
+		sensors.loop();
+
+		if (state == Sensors::State::IDLE && sensors.state() == Sensors::State::READING) {
+			cycle_start_us = host::clock_elapsed_us();
+		}
+
+		if (sensors.generation() != generation) {
+			uint64_t latency_us = host::clock_elapsed_us() - cycle_start_us;
+
+			generation = sensors.generation();
+			cycles++;
+			latency_total_us += latency_us;
+			latency_max_us = std::max(latency_max_us, latency_us);
+		}
+
+		host::clock_advance_us(1000);
+	}
+
+	count_allocations = false;
+
+	double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+	double simulated_s = host::clock_elapsed_us() / 1e6;
+	auto &usage = Memory::usage(Memory::Subsystem::SENSORS);
+
+	printf("Replayed %lu cycles (%lu scratchpad reads, %lu bus operations) in %.1fs simulated, %.3fs wall\n",
+		cycles, bus.reads(), bus.operations(), simulated_s, wall_s);
+	printf("Throughput: %.0f cycles/s, %.0f bus operations/s, %.0f simulated s per wall s\n",
+		cycles / wall_s, bus.operations() / wall_s, simulated_s / wall_s);
+	if (cycles) {
+		printf("Cycle latency: mean %.1fms, max %.1fms (simulated), %.2fus CPU per cycle\n",
+			latency_total_us / 1000.0 / cycles, latency_max_us / 1000.0, wall_s * 1e6 / cycles);
+		printf("Allocations: %lu (%.2f per cycle, %lu bytes), sensors current %zu bytes, peak %zu bytes\n",
+			allocations, (double)allocations / cycles, allocated_bytes, usage.current_, usage.peak_);
+	}
+	printf("Read time per device: %luus full, %luus short (%lu implausible)\n",
+		sensors.full_read_us(), sensors.short_read_us(), sensors.implausible_reads());
+	printf("Errors logged: %lu\n", uuid::log::Logger::count(uuid::log::Level::ERR));
+
+	return cycles > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,639 @@
+/*
+ * fridge - Fridge Controller
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Runs the sensor, door, control, compressor, alarm and history modules
+ * together for weeks of simulated time, against emulated sensors in the
+ * thermal model of a fridge, and checks that nothing goes wrong over time.
+ *
+ * The clock starts just before millis() wraps and the default duration is
+ * long enough for the low 32 bits to wrap again after 49.7 days. Some
+ * faults are scheduled: corrupted reads throughout, one sensor disconnected
+ * for two hours and all of them disconnected for half an hour.
+ *
+ * The modules are driven in the same order as App::loop(), which can't be
+ * built here because it depends on the rest of the application framework.
+ *
+ * Usage: soak [-d days] [-m start_millis] [-s]
+ */
+
+#include <Arduino.h>
+#include <OneWire.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cinttypes>
+#include <climits>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#include <unistd.h>
+
+#include <uuid/common.h>
+#include <uuid/log.h>
+
+#include "app/config.h"
+#include "ds18b20.h"
+#include "fridge/alarms.h"
+#include "fridge/compressor.h"
+#include "fridge/controller.h"
+#include "fridge/door.h"
+#include "fridge/history.h"
+#include "fridge/memory.h"
+#include "fridge/sensors.h"
+#include "thermal_model.h"
+
+using fridge::Alarms;
+using fridge::Compressor;
+using fridge::Controller;
+using fridge::Door;
+using fridge::History;
+using fridge::Memory;
+using fridge::Sensors;
+
+static constexpr int DOOR_PIN = 11;
+static constexpr size_t SENSORS = 4;
+static constexpr double SENSOR_OFFSET_C = 0.25;
+static constexpr unsigned long CORRUPT_INTERVAL = 997;
+
+static constexpr uint64_t MS = 1000;
+static constexpr uint64_t S = 1000 * MS;
+static constexpr uint64_t MINUTE = 60 * S;
+static constexpr uint64_t HOUR = 60 * MINUTE;
+static constexpr uint64_t DAY = 24 * HOUR;
+static constexpr uint64_t WEEK = 7 * DAY;
+
+static constexpr uint64_t BUSY_STEP_US = 1 * MS;
+static constexpr uint64_t IDLE_STEP_US = 100 * MS;
+
+/* Faults, relative to the start of the simulation */
+static constexpr uint64_t ONE_LOST_US = 10 * DAY;
+static constexpr uint64_t ONE_LOST_DURATION_US = 2 * HOUR;
+static constexpr size_t ONE_LOST_SENSOR = 2;
+static constexpr uint64_t ALL_LOST_US = 20 * DAY;
+static constexpr uint64_t ALL_LOST_DURATION_US = 30 * MINUTE;
+/* Time to recover from a fault: the next discovery and a few cycles */
+static constexpr uint64_t RECOVERY_US = 2 * MINUTE;
+
+/* Limits for the checks */
+static constexpr uint64_t MAX_BUSY_US = 3 * S;
+static constexpr uint64_t MAX_CYCLE_GAP_US = 30 * S + 1 * S;
+static constexpr uint64_t MIN_CYCLE_GAP_US = 1 * S;
+static constexpr uint64_t MAX_RELAY_UNCHANGED_US = 6 * HOUR;
+static constexpr uint64_t MAX_FAIL_SAFE_US = 2 * MINUTE + 2 * MINUTE + 30 * S;
+static constexpr uint64_t MAX_HISTORY_LATENESS_US = IDLE_STEP_US + 20 * MS;
+static constexpr uint64_t MAX_RUNTIME_ERROR_MS = 1000;
+static constexpr size_t MAX_HEAP_GROWTH = 0;
+static constexpr double MAX_READING_ERROR_C = 0.6;
+
+/* Every allocation has a header with its size so that live usage is known */
+static constexpr size_t ALLOCATION_HEADER = 16;
+static size_t live_bytes = 0;
+static unsigned long live_allocations = 0;
+
+__attribute__((noinline)) void *operator new(size_t size) {
+	uint8_t *ptr = static_cast<uint8_t *>(std::malloc(size + ALLOCATION_HEADER));
+
+	if (!ptr) {
+		throw std::bad_alloc();
+	}
+
+	*reinterpret_cast<size_t *>(ptr) = size;
+	live_bytes += size;
+	live_allocations++;
+	return ptr + ALLOCATION_HEADER;
+}
+
+__attribute__((noinline)) void operator delete(void *ptr) noexcept {
+	if (ptr) {
+		uint8_t *base = static_cast<uint8_t *>(ptr) - ALLOCATION_HEADER;
+
+		live_bytes -= *reinterpret_cast<size_t *>(base);
+		live_allocations--;
+		std::free(base);
+	}
+}
+
+__attribute__((noinline)) void operator delete(void *ptr, size_t size __attribute__((unused))) noexcept {
+	operator delete(ptr);
+}
+
+namespace {
+
+struct Period {
+	unsigned long cycles = 0;
+	unsigned long readings = 0;
+	unsigned long missed = 0;
+	unsigned long corrupted = 0;
+	unsigned long relay_cycles = 0;
+	uint64_t running_us = 0;
+	uint64_t elapsed_us = 0;
+	uint64_t max_gap_us = 0;
+	uint64_t min_gap_us = UINT64_MAX;
+	uint64_t max_busy_us = 0;
+	double minimum_c = INFINITY;
+	double maximum_c = -INFINITY;
+};
+
+class Soak {
+public:
+	Soak(uint64_t duration_us, bool short_read) : duration_us_(duration_us) {
+		app::Config config;
+
+		config.sensors_short_read(short_read);
+
+		for (size_t i = 0; i < SENSORS; i++) {
+			bus_.add(0x5A0000 + i * 0x010101);
+		}
+		bus_.corrupt_reads(CORRUPT_INTERVAL);
+
+		for (size_t i = 0; i < SENSORS; i++) {
+			ids_[i] = Sensors::Device(bus_.sensor(i).address.data()).id();
+		}
+	}
+
+	bool run();
+
+private:
+	bool fault(uint64_t now_us) const;
+	bool normal(uint64_t now_us) const;
+	void inject(uint64_t now_us);
+	void control();
+	void check_alarms();
+	void check_cycle(uint64_t now_us);
+	void check_history(uint64_t now_us);
+	void end_period(unsigned int number);
+	bool check(bool condition, const char *format, ...) __attribute__((format(printf, 3, 4)));
+
+	uint64_t duration_us_;
+	host::DS18B20Bus bus_;
+	host::ThermalModel model_{5};
+	std::array<uint64_t,SENSORS> ids_{};
+
+	/* Same modules and order as App */
+	Compressor compressor_;
+	Controller controller_;
+	bool control_failed_ = false;
+	unsigned long control_generation_ = 0;
+	Alarms alarms_;
+	unsigned long alarms_generation_ = 0;
+	History history_;
+	Sensors sensors_;
+	Door door_;
+
+	Period period_;
+	Period total_;
+	bool ok_ = true;
+	unsigned long failures_ = 0;
+
+	uint64_t model_us_ = 0;
+	uint64_t last_uptime_ms_ = 0;
+	unsigned long generation_ = 0;
+	uint64_t generation_us_ = 0;
+	uint64_t cycle_end_us_ = 0;
+	uint64_t busy_since_us_ = 0;
+	bool busy_ = false;
+	uint64_t relay_changed_us_ = 0;
+	uint64_t running_us_ = 0;
+	bool running_ = false;
+	uint32_t history_next_ = 0;
+	uint64_t max_history_lateness_us_ = 0;
+	unsigned long no_readings_raised_ = 0;
+	unsigned long no_readings_cleared_ = 0;
+	uint32_t next_event_ = 0;
+	bool stopped_in_outage_ = false;
+
+	size_t baseline_bytes_ = 0;
+	unsigned long baseline_allocations_ = 0;
+	std::array<size_t,Memory::SUBSYSTEMS> baseline_memory_{};
+};
+
+bool Soak::check(bool condition, const char *format, ...) {
+	if (!condition) {
+		va_list ap;
+
+		if (failures_++ < 20) {
+			printf("FAIL at %s: ", uuid::log::format_timestamp_ms(host::clock_elapsed_us() / 1000, 3).c_str());
+			va_start(ap, format);
+			vprintf(format, ap);
+			va_end(ap);
+			printf("\n");
+		}
+		ok_ = false;
+	}
+	return condition;
+}
+
+bool Soak::fault(uint64_t now_us) const {
+	return (now_us >= ONE_LOST_US && now_us < ONE_LOST_US + ONE_LOST_DURATION_US)
+		|| (now_us >= ALL_LOST_US && now_us < ALL_LOST_US + ALL_LOST_DURATION_US);
+}
+
+/* Not during a fault or while recovering from one */
+bool Soak::normal(uint64_t now_us) const {
+	return !fault(now_us) && !(now_us >= RECOVERY_US && fault(now_us - RECOVERY_US));
+}
+
+void Soak::inject(uint64_t now_us) {
+	bool all_lost = now_us >= ALL_LOST_US && now_us < ALL_LOST_US + ALL_LOST_DURATION_US;
+	bool one_lost = now_us >= ONE_LOST_US && now_us < ONE_LOST_US + ONE_LOST_DURATION_US;
+
+	for (size_t i = 0; i < SENSORS; i++) {
+		bus_.sensor(i).present = !all_lost && !(one_lost && i == ONE_LOST_SENSOR);
+		bus_.sensor(i).temperature_c = model_.temperature_c() + i * SENSOR_OFFSET_C;
+	}
+
+	if (all_lost && running_ && !stopped_in_outage_
+			&& now_us - ALL_LOST_US > MAX_FAIL_SAFE_US) {
+		check(false, "compressor still running %" PRIu64 "s after all sensors were lost",
+			(now_us - ALL_LOST_US) / S);
+		stopped_in_outage_ = true;
+	} else if (all_lost && !running_) {
+		stopped_in_outage_ = true;
+	}
+
+	/* The door switch is closed (high) when the door is closed */
+	host::pin_input(DOOR_PIN, model_.door_open() ? LOW : HIGH);
+}
+
+/* As App::control() */
+void Soak::control() {
+	unsigned long generation = sensors_.generation();
+	bool running;
+
+	if (alarms_.no_readings()) {
+		running = controller_.fail_safe(uuid::get_uptime_ms(), compressor_.running(), compressor_.last_change_ms());
+		control_failed_ = true;
+	} else if (generation == control_generation_) {
+		return;
+	} else {
+		float total_c = 0;
+		unsigned int count = 0;
+
+		control_generation_ = generation;
+
+		for (auto &device : sensors_.devices()) {
+			if (!std::isnan(device.temperature_c_)) {
+				total_c += device.temperature_c_;
+				count++;
+			}
+		}
+
+		if (count == 0) {
+			running = controller_.fail_safe(uuid::get_uptime_ms(), compressor_.running(), compressor_.last_change_ms());
+			control_failed_ = true;
+		} else {
+			app::Config config;
+
+			control_failed_ = false;
+			running = controller_.update(uuid::get_uptime_ms(), total_c / count,
+				compressor_.running(), config.minimum_temperature(),
+				config.maximum_temperature(), config.predictive_control());
+		}
+	}
+
+	if (running != compressor_.running()) {
+		uint64_t now_us = host::clock_elapsed_us();
+
+		compressor_.running(running);
+		if (running) {
+			period_.relay_cycles++;
+		}
+		relay_changed_us_ = now_us;
+		running_ = running;
+	}
+}
+
+/* As App::check_alarms() */
+void Soak::check_alarms() {
+	unsigned long generation = sensors_.generation();
+
+	if (generation != alarms_generation_) {
+		alarms_generation_ = generation;
+		alarms_.update(sensors_.devices());
+	}
+
+	alarms_.loop();
+
+	for (; next_event_ != alarms_.next_sequence(); next_event_++) {
+		const Alarms::Event *event = alarms_.event(next_event_);
+
+		if (!event) {
+			continue;
+		}
+
+		switch (event->type) {
+		case Alarms::Type::NO_READINGS_RAISED:
+			no_readings_raised_++;
+			check(fault(host::clock_elapsed_us()), "no readings alarm raised outside a fault");
+			break;
+
+		case Alarms::Type::NO_READINGS_CLEARED:
+			no_readings_cleared_++;
+			break;
+
+		case Alarms::Type::ACKNOWLEDGED:
+			break;
+
+		default:
+			check(false, "unexpected %s alarm event", reinterpret_cast<const char *>(Alarms::type_name(event->type)));
+			break;
+		}
+	}
+
+	if (alarms_.buzzer()) {
+		alarms_.acknowledge();
+	}
+}
+
+void Soak::check_cycle(uint64_t now_us) {
+	bool normal = this->normal(now_us);
+	uint64_t gap_us = now_us - generation_us_;
+
+	if (generation_us_ != 0 && normal && this->normal(generation_us_)) {
+		period_.max_gap_us = std::max(period_.max_gap_us, gap_us);
+		check(gap_us <= MAX_CYCLE_GAP_US, "%" PRIu64 "ms between readings", gap_us / MS);
+	}
+
+	generation_us_ = now_us;
+	period_.cycles++;
+
+	for (auto &device : sensors_.devices()) {
+		size_t index = std::find(ids_.begin(), ids_.end(), device.id()) - ids_.begin();
+
+		if (!check(index < SENSORS, "unknown device %s", device.to_string().c_str())) {
+			continue;
+		}
+
+		if (std::isnan(device.temperature_c_)) {
+			if (normal) {
+				period_.missed++;
+			}
+			continue;
+		}
+
+		period_.readings++;
+		check(std::abs(device.temperature_c_ - bus_.sensor(index).temperature_c) <= MAX_READING_ERROR_C,
+			"device %zu read %.3fC, expected %.3fC", index, device.temperature_c_,
+			bus_.sensor(index).temperature_c);
+	}
+
+	if (normal) {
+		check(sensors_.devices().size() == SENSORS, "%zu devices, expected %zu",
+			sensors_.devices().size(), SENSORS);
+	}
+}
+
+/*
+ * Samples are scheduled every minute from the start, so each one should be
+ * taken within one loop pass of its scheduled time regardless of how long
+ * the simulation has been running.
+ */
+void Soak::check_history(uint64_t now_us) {
+	if (history_.next() == history_next_) {
+		return;
+	}
+
+	history_next_ = history_.next();
+
+	uint64_t lateness_us = now_us % (History::SAMPLE_INTERVAL_MS * MS);
+
+	max_history_lateness_us_ = std::max(max_history_lateness_us_, lateness_us);
+	check(lateness_us <= MAX_HISTORY_LATENESS_US, "history sample %" PRIu64 "ms late", lateness_us / MS);
+}
+
+void Soak::end_period(unsigned int number) {
+	std::array<size_t,Memory::SUBSYSTEMS> memory;
+
+	period_.corrupted = bus_.corrupted_reads() - total_.corrupted;
+
+	for (size_t i = 0; i < Memory::SUBSYSTEMS; i++) {
+		memory[i] = Memory::usage(static_cast<Memory::Subsystem>(i)).current_;
+	}
+
+	printf("%4u %7lu %9lu %6lu %7lu %7.1fs %6.0fms %6lu %5.1f%% %5.2f %5.2f %8zu %6lu %7zu %7zu\n",
+		number, period_.cycles, period_.readings, period_.missed, period_.corrupted,
+		period_.max_gap_us / 1e6, period_.max_busy_us / 1e3, period_.relay_cycles,
+		100.0 * period_.running_us / period_.elapsed_us, period_.minimum_c, period_.maximum_c,
+		live_bytes, live_allocations,
+		memory[static_cast<size_t>(Memory::Subsystem::SENSORS)],
+		memory[static_cast<size_t>(Memory::Subsystem::HISTORY)]);
+
+	/* Missed readings are only expected from corrupted reads */
+	check(period_.missed <= period_.corrupted, "%lu missed readings with %lu corrupted reads",
+		period_.missed, period_.corrupted);
+	check(period_.relay_cycles > 0, "compressor never started");
+
+	if (number == 1) {
+		baseline_bytes_ = live_bytes;
+		baseline_allocations_ = live_allocations;
+		baseline_memory_ = memory;
+	} else {
+		check(live_bytes <= baseline_bytes_ + MAX_HEAP_GROWTH, "heap grew from %zu to %zu bytes",
+			baseline_bytes_, live_bytes);
+		check(live_allocations <= baseline_allocations_, "live allocations grew from %lu to %lu",
+			baseline_allocations_, live_allocations);
+		for (size_t i = 0; i < Memory::SUBSYSTEMS; i++) {
+			check(memory[i] <= baseline_memory_[i], "%s memory grew from %zu to %zu bytes",
+				reinterpret_cast<const char *>(Memory::subsystem_name(static_cast<Memory::Subsystem>(i))),
+				baseline_memory_[i], memory[i]);
+		}
+	}
+
+	total_.cycles += period_.cycles;
+	total_.readings += period_.readings;
+	total_.missed += period_.missed;
+	total_.corrupted += period_.corrupted;
+	total_.relay_cycles += period_.relay_cycles;
+	total_.running_us += period_.running_us;
+	total_.elapsed_us += period_.elapsed_us;
+	period_ = Period{};
+}
+
+bool Soak::run() {
+	auto wall_start = std::chrono::steady_clock::now();
+	uint64_t period_end_us = WEEK;
+	unsigned int period = 1;
+	unsigned long start_millis = millis();
+
+	host::onewire_attach(&bus_);
+	inject(0);
+
+	alarms_.start();
+	compressor_.start();
+	sensors_.start(0);
+	door_.start(DOOR_PIN);
+	history_.start();
+
+	printf("Week  Cycles  Readings Missed Corrupt  MaxGap  MaxBusy Relay  Duty   MinC  MaxC     Heap Allocs Sensors History\n");
+
+	while (host::clock_elapsed_us() < duration_us_) {
+		uint64_t now_us = host::clock_elapsed_us();
+		uint64_t uptime_ms = uuid::get_uptime_ms();
+
+		check(uptime_ms >= last_uptime_ms_, "uptime went backwards");
+		last_uptime_ms_ = uptime_ms;
+
+		model_.step(model_us_ / 1e6, (now_us - model_us_) / 1e6, running_);
+		if (running_) {
+			period_.running_us += now_us - model_us_;
+			running_us_ += now_us - model_us_;
+		}
+		period_.elapsed_us += now_us - model_us_;
+		period_.minimum_c = std::min(period_.minimum_c, model_.temperature_c());
+		period_.maximum_c = std::max(period_.maximum_c, model_.temperature_c());
+		model_us_ = now_us;
+
+		inject(now_us);
+
+		/* Same order as App::loop() */
+		Memory::loop();
+		compressor_.loop();
+		door_.loop();
+		sensors_.door_open(door_.open());
+		sensors_.loop();
+		control();
+		check_alarms();
+		history_.loop(sensors_.devices());
+		uuid::loop();
+
+		now_us = host::clock_elapsed_us();
+
+		if (sensors_.generation() != generation_) {
+			generation_ = sensors_.generation();
+			check_cycle(now_us);
+		}
+		check_history(now_us);
+
+		if (sensors_.state() == Sensors::State::IDLE) {
+			if (busy_ && normal(now_us)) {
+				period_.max_busy_us = std::max(period_.max_busy_us, now_us - busy_since_us_);
+				check(now_us - busy_since_us_ <= MAX_BUSY_US, "sensors busy for %" PRIu64 "ms",
+					(now_us - busy_since_us_) / MS);
+			}
+			busy_ = false;
+		} else if (!busy_) {
+			busy_ = true;
+			busy_since_us_ = now_us;
+		}
+
+		if (normal(now_us)) {
+			check(now_us - relay_changed_us_ <= MAX_RELAY_UNCHANGED_US, "relay unchanged for %" PRIu64 "s",
+				(now_us - relay_changed_us_) / S);
+		} else {
+			relay_changed_us_ = now_us;
+		}
+
+		if (now_us >= period_end_us) {
+			end_period(period++);
+			period_end_us += WEEK;
+		}
+
+		host::clock_advance_us(busy_ || sensors_.state() != Sensors::State::IDLE ? BUSY_STEP_US : IDLE_STEP_US);
+	}
+
+	if (period_.elapsed_us > 0) {
+		end_period(period);
+	}
+
+	double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+	double simulated_s = host::clock_elapsed_us() / 1e6;
+	unsigned int wraps = millis() < start_millis ? 1 : 0;
+	unsigned int low_wraps = (((uint64_t)(uint32_t)start_millis + host::clock_elapsed_us() / MS) >> 32);
+	int64_t runtime_error_ms = (int64_t)compressor_.runtime_ms() - (int64_t)(running_us_ / MS);
+
+	printf("\n");
+	printf("Simulated %.1f days from millis() %#lx in %.1fs: %.0f simulated s per wall s\n",
+		simulated_s / 86400, start_millis, wall_s, simulated_s / wall_s);
+	printf("millis() wrapped %u times, the low 32 bits wrapped %u times\n", wraps, low_wraps);
+	printf("%lu cycles, %lu readings, %lu missed, %lu corrupted reads, %lu compressor cycles, %.1f%% duty\n",
+		total_.cycles, total_.readings, total_.missed, total_.corrupted, total_.relay_cycles,
+		100.0 * total_.running_us / total_.elapsed_us);
+	printf("History samples at most %" PRIu64 "ms late, compressor runtime error %" PRId64 "ms\n",
+		max_history_lateness_us_ / MS, runtime_error_ms);
+	printf("No readings alarms raised %lu, cleared %lu\n", no_readings_raised_, no_readings_cleared_);
+	printf("Log messages: %lu alert, %lu error, %lu warning, %lu notice\n",
+		uuid::log::Logger::count(uuid::log::Level::ALERT), uuid::log::Logger::count(uuid::log::Level::ERR),
+		uuid::log::Logger::count(uuid::log::Level::WARNING), uuid::log::Logger::count(uuid::log::Level::NOTICE));
+	printf("\n");
+
+	check(std::abs(runtime_error_ms) <= (int64_t)MAX_RUNTIME_ERROR_MS, "compressor runtime differs by %" PRId64 "ms",
+		runtime_error_ms);
+
+	if (duration_us_ > ALL_LOST_US + ALL_LOST_DURATION_US + RECOVERY_US) {
+		check(no_readings_raised_ == 1 && no_readings_cleared_ == 1,
+			"no readings alarm raised %lu times and cleared %lu times", no_readings_raised_, no_readings_cleared_);
+		check(stopped_in_outage_, "compressor not stopped while all sensors were lost");
+	}
+
+	if (failures_ > 20) {
+		printf("%lu more failures\n", failures_ - 20);
+	}
+
+	printf("%s\n", ok_ ? "PASS" : "FAIL");
+	return ok_;
+}
+
+} // namespace
+
+static int usage(const char *name) {
+	fprintf(stderr, "Usage: %s [-d days] [-m start_millis] [-s]\n", name);
+	return EXIT_FAILURE;
+}
+
+int main(int argc, char *argv[]) {
+	unsigned long days = 56;
+	unsigned long start_millis = ULONG_MAX - 10 * 60 * 1000;
+	bool short_read = false;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "d:m:s")) != -1) {
+		switch (opt) {
+		case 'd':
+			days = std::strtoul(optarg, nullptr, 10);
+			break;
+
+		case 'm':
+			start_millis = std::strtoul(optarg, nullptr, 0);
+			break;
+
+		case 's':
+			short_read = true;
+			break;
+
+		default:
+			return usage(argv[0]);
+		}
+	}
+
+	if (optind != argc || days == 0) {
+		return usage(argv[0]);
+	}
+
+	uuid::log::Logger::level(uuid::log::Level::CRIT);
+	host::clock_start(start_millis);
+
+	Soak soak{days * DAY, short_read};
+
+	return soak.run() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
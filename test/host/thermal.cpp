@@ -0,0 +1,225 @@
+/*
+ * fridge - Fridge Controller
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Compares hysteresis and predictive control of the thermal model over
+ * several simulated days.
+ *
+ * Usage: thermal [days]
+ */
+
+#include <Arduino.h>
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include <uuid/log.h>
+
+#include "fridge/controller.h"
+#include "thermal_model.h"
+
+static constexpr float MINIMUM_C = 3.0f;
+static constexpr float MAXIMUM_C = 5.0f;
+static constexpr unsigned long SAMPLE_INTERVAL_S = 30;
+static constexpr unsigned long WARMUP_S = 86400;
+static constexpr unsigned long MINIMUM_RUN_S = 2 * 60;
+static constexpr unsigned long MINIMUM_REST_S = 5 * 60;
+static constexpr double POWER_W = 100;
+
+struct Result {
+	unsigned long cycles = 0;
+	unsigned long running_s = 0;
+	unsigned long total_s = 0;
+	unsigned long outside_s = 0;
+	double outside_c_h = 0; /*!< Degree hours beyond the limits */
+	double minimum_c = INFINITY;
+	double maximum_c = -INFINITY;
+	unsigned long shortest_run_s = ULONG_MAX;
+	unsigned long shortest_rest_s = ULONG_MAX;
+	double trough_total_c = 0; /*!< Lowest temperature of each cycle */
+	double peak_total_c = 0; /*!< Highest temperature of each cycle */
+
+	double mean_trough_c() const { return cycles ? trough_total_c / cycles : NAN; }
+	double mean_peak_c() const { return cycles ? peak_total_c / cycles : NAN; }
+};
+
+static Result simulate(bool predictive, unsigned long days,
+		float minimum_c = MINIMUM_C, float maximum_c = MAXIMUM_C) {
+	fridge::Controller controller;
+	host::ThermalModel model{MAXIMUM_C};
+	Result result;
+	bool running = false;
+	unsigned long changed_s = 0;
+	unsigned long end_s = WARMUP_S + days * 86400;
+	double trough_c = INFINITY;
+	double peak_c = -INFINITY;
+
+	for (unsigned long time_s = 0; time_s < end_s; time_s++) {
+		if (time_s % SAMPLE_INTERVAL_S == 0) {
+			/* DS18B20 readings are in sixteenths of a degree */
+			float reading_c = std::round(model.temperature_c() * 16) / 16;
+			bool value = controller.update((uint64_t)time_s * 1000, reading_c, running,
+				minimum_c, maximum_c, predictive);
+
+			if (value != running) {
+				if (time_s >= WARMUP_S) {
+					if (running) {
+						result.shortest_run_s = std::min(result.shortest_run_s, time_s - changed_s);
+					} else {
+						result.shortest_rest_s = std::min(result.shortest_rest_s, time_s - changed_s);
+						result.cycles++;
+						result.trough_total_c += trough_c;
+						result.peak_total_c += peak_c;
+					}
+				}
+
+				/* A cycle's peak follows the start and its trough follows the stop */
+				if (value) {
+					trough_c = INFINITY;
+					peak_c = -INFINITY;
+				}
+
+				running = value;
+				changed_s = time_s;
+			}
+		}
+
+		model.step(time_s, 1, running);
+
+		if (time_s >= WARMUP_S) {
+			double temperature_c = model.temperature_c();
+			double outside_c = std::max(temperature_c - MAXIMUM_C, MINIMUM_C - temperature_c);
+
+			result.total_s++;
+			if (running) {
+				result.running_s++;
+			}
+			if (outside_c > 0) {
+				result.outside_s++;
+				result.outside_c_h += outside_c / 3600;
+			}
+			result.minimum_c = std::min(result.minimum_c, temperature_c);
+			result.maximum_c = std::max(result.maximum_c, temperature_c);
+		}
+
+		trough_c = std::min(trough_c, model.temperature_c());
+		peak_c = std::max(peak_c, model.temperature_c());
+	}
+
+	return result;
+}
+
+static void report(const char *name, const Result &result, unsigned long days) {
+	printf("%-11s %9.1f %6.1f%% %8.3f %7.2f %7.2f %7.2f %7.2f %8.1f%% %9.2f %6lus %6lus\n", name,
+		(double)result.cycles / days, 100.0 * result.running_s / result.total_s,
+		POWER_W * result.running_s / 3600 / 1000 / days,
+		result.minimum_c, result.maximum_c, result.mean_trough_c(), result.mean_peak_c(),
+		100.0 * result.outside_s / result.total_s, result.outside_c_h,
+		result.shortest_run_s, result.shortest_rest_s);
+}
+
+static bool check(bool condition, const char *name, const char *message) {
+	if (!condition) {
+		printf("FAIL: %s: %s\n", name, message);
+	}
+	return condition;
+}
+
+static bool check_limits(const char *name, const Result &result) {
+	bool ok = true;
+
+	ok &= check(result.cycles > 0, name, "compressor never cycled");
+	ok &= check(result.shortest_run_s >= MINIMUM_RUN_S, name, "minimum run time not respected");
+	ok &= check(result.shortest_rest_s >= MINIMUM_REST_S, name, "minimum rest time not respected");
+	ok &= check(result.minimum_c > MINIMUM_C - 2 && result.maximum_c < MAXIMUM_C + 2,
+		name, "temperature more than 2C outside the limits");
+	return ok;
+}
+
+/*
+ * Without readings the compressor must stop, but not before it has run for
+ * the minimum time, and must not restart by itself.
+ */
+static bool check_fail_safe() {
+	fridge::Controller controller;
+	uint64_t now_ms = 86400 * 1000;
+	bool ok = true;
+
+	ok &= check(controller.fail_safe(now_ms, true, now_ms - (MINIMUM_RUN_S - 1) * 1000),
+		"fail safe", "stopped before the minimum run time");
+	ok &= check(!controller.fail_safe(now_ms, true, now_ms - MINIMUM_RUN_S * 1000),
+		"fail safe", "still running after the minimum run time");
+	ok &= check(!controller.fail_safe(now_ms, false, now_ms - MINIMUM_RUN_S * 1000),
+		"fail safe", "started the compressor");
+	ok &= check(!controller.update(now_ms, MAXIMUM_C + 1, false, MINIMUM_C, MAXIMUM_C, true),
+		"fail safe", "restarted within the minimum rest time when readings resumed");
+	return ok;
+}
+
+int main(int argc, char *argv[]) {
+	unsigned long days = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 14;
+
+	if (days == 0) {
+		fprintf(stderr, "Usage: %s [days]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	uuid::log::Logger::level(uuid::log::Level::WARNING);
+
+	Result hysteresis = simulate(false, days);
+	/*
+	 * Hysteresis control can only stay inside the range if the limits are
+	 * moved in by its average overshoot, which would have to be tuned by
+	 * hand for each fridge. This is the baseline for the number of cycles
+	 * because a smaller temperature swing needs more cycles.
+	 */
+	Result tuned = simulate(false, days,
+		MINIMUM_C + (MINIMUM_C - hysteresis.mean_trough_c()),
+		MAXIMUM_C - (hysteresis.mean_peak_c() - MAXIMUM_C));
+	Result predictive = simulate(true, days);
+	bool ok = true;
+
+	printf("Range %.1f-%.1fC, %lus samples, %lu days after %lus warm up\n\n",
+		MINIMUM_C, MAXIMUM_C, SAMPLE_INTERVAL_S, days, WARMUP_S);
+	printf("%-11s %9s %7s %8s %7s %7s %7s %7s %9s %9s %7s %7s\n", "Mode", "Cycles/d", "Duty",
+		"kWh/d", "Min C", "Max C", "Trough", "Peak", "Outside", "Outside", "MinRun", "MinRest");
+	printf("%-11s %9s %7s %8s %7s %7s %7s %7s %9s %9s %7s %7s\n", "", "", "", "", "", "", "mean C", "mean C",
+		"time", "C.h", "", "");
+	report("hysteresis", hysteresis, days);
+	report("tuned", tuned, days);
+	report("predictive", predictive, days);
+	printf("\n");
+
+	ok &= check_limits("hysteresis", hysteresis);
+	ok &= check_limits("tuned", tuned);
+	ok &= check_limits("predictive", predictive);
+	ok &= check(predictive.outside_c_h < hysteresis.outside_c_h, "predictive",
+		"overshoot beyond the limits is not lower than hysteresis control");
+	ok &= check(std::abs(predictive.mean_trough_c() - MINIMUM_C) <= 0.1
+		&& std::abs(predictive.mean_peak_c() - MAXIMUM_C) <= 0.1, "predictive",
+		"troughs and peaks are not at the limits on average");
+	ok &= check(predictive.cycles <= tuned.cycles, "predictive",
+		"more cycles than hysteresis control tuned to stay inside the limits");
+	ok &= check_fail_safe();
+
+	printf("%s\n", ok ? "PASS" : "FAIL");
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
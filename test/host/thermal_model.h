@@ -0,0 +1,77 @@
+/*
+ * fridge - Fridge Controller
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+namespace host {
+
+/**
+ * Two-mass thermal model of a fridge.
+ *
+ * The compressor removes heat from the evaporator, which cools the air
+ * and contents. The evaporator is what gives the controller a lag to learn:
+ * the air keeps cooling for a while after the compressor stops. The ambient
+ * temperature varies over the day and the door is opened a few times a day.
+ */
+class ThermalModel {
+public:
+	static constexpr double CONTENTS_J_PER_K = 20000;
+	static constexpr double EVAPORATOR_J_PER_K = 2000;
+	static constexpr double AMBIENT_W_PER_K = 0.8;
+	static constexpr double DOOR_OPEN_W_PER_K = 15;
+	static constexpr double EVAPORATOR_W_PER_K = 5;
+	static constexpr double COOLING_W = 60;
+	static constexpr double AMBIENT_C = 21;
+	static constexpr double AMBIENT_SWING_C = 3;
+	static constexpr unsigned int DOOR_OPENINGS = 6; /*!< Per day */
+	static constexpr unsigned int DOOR_OPEN_S = 30;
+
+	ThermalModel(double temperature_c = AMBIENT_C)
+			: contents_c_(temperature_c), evaporator_c_(temperature_c) {
+	}
+
+	void step(double time_s, double dt_s, bool running) {
+		double day_s = std::fmod(time_s, 86400);
+		double ambient_c = AMBIENT_C + AMBIENT_SWING_C * std::sin(day_s / 86400 * 2 * M_PI);
+		double ambient_w_per_k = AMBIENT_W_PER_K;
+
+		door_open_ = std::fmod(day_s, 86400.0 / DOOR_OPENINGS) < DOOR_OPEN_S;
+		if (door_open_) {
+			ambient_w_per_k += DOOR_OPEN_W_PER_K;
+		}
+
+		double exchange_w = EVAPORATOR_W_PER_K * (contents_c_ - evaporator_c_);
+		double ambient_w = ambient_w_per_k * (ambient_c - contents_c_);
+
+		contents_c_ += (ambient_w - exchange_w) * dt_s / CONTENTS_J_PER_K;
+		evaporator_c_ += (exchange_w - (running ? COOLING_W : 0)) * dt_s / EVAPORATOR_J_PER_K;
+	}
+
+	double temperature_c() const { return contents_c_; }
+	bool door_open() const { return door_open_; }
+
+private:
+	double contents_c_;
+	double evaporator_c_;
+	bool door_open_ = false;
+};
+
+} // namespace host
@@ -0,0 +1,147 @@
+/*
+ * fridge - Fridge Controller
+ * Copyright 2022  Simon Arlott
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <WiFi.h>
+#include <WiFiUdp.h>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+WiFiClass WiFi;
+
+static IPAddress local_ip;
+static std::vector<WiFiUDP *> sockets;
+static unsigned int drop_count = 0;
+
+bool WiFiClass::isConnected() {
+	return (uint32_t)local_ip != 0;
+}
+
+IPAddress WiFiClass::localIP() {
+	return local_ip;
+}
+
+WiFiUDP::~WiFiUDP() {
+	stop();
+}
+
+uint8_t WiFiUDP::beginMulticast(IPAddress address, uint16_t port) {
+	if (!WiFi.isConnected()) {
+		return 0;
+	}
+
+	stop();
+	joined_ = true;
+	group_ = address;
+	port_ = port;
+	sockets.push_back(this);
+	return 1;
+}
+
+void WiFiUDP::stop() {
+	if (joined_) {
+		sockets.erase(std::find(sockets.begin(), sockets.end(), this));
+		joined_ = false;
+	}
+
+	queue_.clear();
+	current_ = {};
+	position_ = 0;
+}
+
+int WiFiUDP::parsePacket() {
+	if (queue_.empty()) {
+		current_ = {};
+		return 0;
+	}
+
+	current_ = std::move(queue_.front());
+	queue_.pop_front();
+	position_ = 0;
+	return current_.data.size();
+}
+
+IPAddress WiFiUDP::remoteIP() {
+	return current_.remote;
+}
+
+int WiFiUDP::read(uint8_t *buffer, size_t len) {
+	len = std::min(len, current_.data.size() - position_);
+	std::memcpy(buffer, &current_.data[position_], len);
+	position_ += len;
+	return len;
+}
+
+void WiFiUDP::flush() {
+	position_ = current_.data.size();
+}
+
+int WiFiUDP::beginMulticastPacket() {
+	if (!joined_) {
+		return 0;
+	}
+
+	sending_.clear();
+	return 1;
+}
+
+size_t WiFiUDP::write(const uint8_t *buffer, size_t size) {
+	sending_.insert(sending_.end(), buffer, buffer + size);
+	return size;
+}
+
+int WiFiUDP::endPacket() {
+	if (!joined_) {
+		return 0;
+	}
+
+	if (drop_count > 0) {
+		drop_count--;
+	} else {
+		deliver(group_, port_, WiFi.localIP(), sending_);
+	}
+	sending_.clear();
+	return 1;
+}
+
+/* Frames are discarded if the receive queue is full, as on the device */
+void WiFiUDP::deliver(IPAddress group, uint16_t port, IPAddress remote, const std::vector<uint8_t> &data) {
+	for (auto *socket : sockets) {
+		if ((uint32_t)socket->group_ == (uint32_t)group && socket->port_ == port
+				&& socket->queue_.size() < MAX_QUEUED) {
+			socket->queue_.push_back({remote, data});
+		}
+	}
+}
+
+namespace host {
+
+void wifi_local_ip(IPAddress address) {
+	local_ip = address;
+}
+
+void udp_drop(unsigned int count) {
+	drop_count += count;
+}
+
+void udp_send(IPAddress group, uint16_t port, IPAddress remote, const uint8_t *data, size_t len) {
+	WiFiUDP::deliver(group, port, remote, std::vector<uint8_t>(data, data + len));
+}
+
+} // namespace host
@@ -0,0 +1,188 @@
+#!/usr/bin/env python3
+# fridge - Fridge Controller
+# Copyright 2022  Simon Arlott
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+"""Decode and summarise the output of the "show trace" console command, or
+replay it through the sensor engine built for the host (test/host)."""
+
+import argparse
+import collections
+import os
+import re
+import statistics
+import struct
+import subprocess
+import sys
+import tempfile
+
+OPERATIONS = {
+	1: "RESET",
+	2: "SKIP",
+	3: "SELECT",
+	4: "WRITE",
+	5: "READ_BIT",
+	6: "READ_BYTES",
+	7: "RESET_SEARCH",
+	8: "SEARCH",
+	9: "DEPOWER",
+	10: "CYCLE",
+	11: "POLL",
+}
+
+HEADER = struct.Struct("<BBIH")
+POLL = struct.Struct("<HBI")
+REPLAY = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "test", "host", "build", "replay")
+CMD_READ_SCRATCHPAD = 0xBE
+HEX_LINE = re.compile(r"^[0-9A-Fa-f]+$")
+
+
+def read_trace(f):
+	data = bytearray()
+	for line in f:
+		line = line.strip()
+		if HEX_LINE.match(line):
+			data += bytes.fromhex(line)
+	return bytes(data)
+
+
+def records(data):
+	offset = 0
+	while offset + HEADER.size <= len(data):
+		operation, length, start_us, duration_us = HEADER.unpack_from(data, offset)
+		offset += HEADER.size
+		yield (OPERATIONS.get(operation, str(operation)), start_us, duration_us,
+			data[offset:offset + length])
+		offset += length
+
+
+def bus_time(operation, duration_us, data):
+	"""Polls are recorded once with the total time of all the reads."""
+	if operation == "POLL" and len(data) >= POLL.size:
+		return POLL.unpack_from(data)[2]
+	return duration_us
+
+
+def replay(args, data):
+	with tempfile.NamedTemporaryFile(suffix=".bin") as f:
+		f.write(data)
+		f.flush()
+		command = [args.replay, "-r", str(args.repeat), "-i", str(args.interval)]
+		if args.short_read:
+			command.append("-s")
+		return subprocess.call(command + [f.name])
+
+
+def main():
+	parser = argparse.ArgumentParser(description=__doc__)
+	parser.add_argument("file", nargs="?", type=argparse.FileType("r"), default=sys.stdin)
+	parser.add_argument("-v", "--verbose", action="store_true", help="print every record")
+	parser.add_argument("-o", "--output", type=argparse.FileType("wb"), help="write the binary trace to a file")
+	parser.add_argument("--replay", nargs="?", const=REPLAY, metavar="PROGRAM",
+		help="benchmark the sensor engine by replaying the trace (default program: %(const)s)")
+	parser.add_argument("-r", "--repeat", type=int, default=100, help="number of times to replay the scratchpad reads")
+	parser.add_argument("-i", "--interval", type=int, default=1000, help="sample interval for the replay (ms)")
+	parser.add_argument("-s", "--short-read", action="store_true", help="enable short scratchpad reads for the replay")
+	args = parser.parse_args()
+
+	data = read_trace(args.file)
+	if args.output:
+		args.output.write(data)
+		args.output.close()
+	if args.replay:
+		sys.exit(replay(args, data))
+
+	counts = collections.Counter()
+	bus_us = collections.Counter()
+	cycles = []
+	cycle_start_us = None
+	cycle_bus_us = 0
+	first_us = None
+	last_us = None
+	# Scratchpad reads from the reset before the select to the reset after the data
+	reads = collections.defaultdict(list)
+	read_us = None
+	read_len = None
+	last_reset_us = 0
+
+	for operation, start_us, duration_us, data in records(data):
+		if args.verbose:
+			if operation == "POLL" and len(data) >= POLL.size:
+				polls, value, poll_us = POLL.unpack_from(data)
+				print(f"{start_us:10d} {duration_us:5d}us {operation:12s} {polls} reads in {poll_us}us, final {value}")
+			else:
+				print(f"{start_us:10d} {duration_us:5d}us {operation:12s} {data.hex()}")
+
+		duration_us = bus_time(operation, duration_us, data)
+
+		if first_us is None:
+			first_us = start_us
+		last_us = start_us + duration_us
+
+		if operation == "CYCLE":
+			if cycle_start_us is not None:
+				cycles.append(((start_us - cycle_start_us) & 0xFFFFFFFF, cycle_bus_us))
+			cycle_start_us = None
+			cycle_bus_us = 0
+			continue
+
+		if operation == "RESET":
+			if read_us is not None and read_len is not None:
+				reads[read_len].append(read_us + duration_us)
+			read_us = None
+			read_len = None
+			last_reset_us = duration_us
+		elif operation == "SELECT":
+			read_us = last_reset_us + duration_us
+		elif read_us is not None:
+			if operation == "WRITE" and data == bytes([CMD_READ_SCRATCHPAD]) and read_len is None:
+				read_us += duration_us
+			elif operation == "READ_BYTES" and read_len is None:
+				read_us += duration_us
+				read_len = len(data)
+			else:
+				read_us = None
+
+		if cycle_start_us is None:
+			cycle_start_us = start_us
+		counts[operation] += 1
+		bus_us[operation] += duration_us
+		cycle_bus_us += duration_us
+
+	if first_us is None:
+		print("No records")
+		return
+
+	elapsed_us = (last_us - first_us) & 0xFFFFFFFF
+	total = sum(counts.values())
+	print(f"{total} operations in {elapsed_us / 1e6:.3f}s"
+		+ (f" ({total / (elapsed_us / 1e6):.1f}/s)" if elapsed_us else ""))
+	for operation, count in sorted(counts.items()):
+		print(f"  {operation:12s} {count:6d} {bus_us[operation]:10d}us")
+
+	if cycles:
+		latency = [cycle[0] for cycle in cycles]
+		busy = [cycle[1] for cycle in cycles]
+		print(f"{len(cycles)} cycles: latency mean {statistics.mean(latency) / 1000:.1f}ms"
+			f" max {max(latency) / 1000:.1f}ms, bus time mean {statistics.mean(busy) / 1000:.1f}ms"
+			f" max {max(busy) / 1000:.1f}ms")
+
+	for length, durations in sorted(reads.items()):
+		print(f"{len(durations)} scratchpad reads of {length} bytes: mean {statistics.mean(durations):.0f}us"
+			f" max {max(durations)}us per device")
+
+
+if __name__ == "__main__":
+	main()
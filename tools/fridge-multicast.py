@@ -0,0 +1,184 @@
+#!/usr/bin/env python3
+# fridge - Fridge Controller
+# Copyright 2022  Simon Arlott
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+"""Listen for (or simulate) multicast status frames from fridge controllers."""
+
+import argparse
+import random
+import socket
+import struct
+import time
+
+GROUP = "239.255.70.68"
+PORT = 37322
+
+MAGIC = 0x47445246
+VERSION = 1
+MAX_SENSORS = 8
+UNKNOWN_TEMPERATURE = -0x8000
+PEER_TIMEOUT = 60
+
+FLAG_RELAY = 1 << 0
+FLAG_RELAY_AUTO = 1 << 1
+FLAG_DOOR_OPEN = 1 << 2
+FLAG_ALARM = 1 << 3
+FLAG_ALARM_UNACKNOWLEDGED = 1 << 4
+
+HEADER = struct.Struct("<IBBBBII16s")
+SENSOR = struct.Struct("<Qh")
+FRAME_LEN = HEADER.size + MAX_SENSORS * SENSOR.size
+
+
+def encode(sequence, uptime_s, hostname, flags, sensors):
+	frame = HEADER.pack(MAGIC, VERSION, flags, len(sensors), 0, sequence & 0xFFFFFFFF,
+		uptime_s & 0xFFFFFFFF, hostname.encode()[:16])
+	for i in range(MAX_SENSORS):
+		if i < len(sensors):
+			address, temperature_c = sensors[i]
+			value = UNKNOWN_TEMPERATURE if temperature_c is None else round(temperature_c * 16)
+			frame += SENSOR.pack(address, value)
+		else:
+			frame += SENSOR.pack(0, UNKNOWN_TEMPERATURE)
+	return frame
+
+
+def decode(frame):
+	if len(frame) != FRAME_LEN:
+		return None
+	magic, version, flags, count, _, sequence, uptime_s, hostname = HEADER.unpack_from(frame)
+	if magic != MAGIC or version != VERSION:
+		return None
+	temperatures = []
+	for i in range(min(count, MAX_SENSORS)):
+		_, value = SENSOR.unpack_from(frame, HEADER.size + i * SENSOR.size)
+		temperatures.append(None if value == UNKNOWN_TEMPERATURE else value / 16)
+	return {
+		"hostname": hostname.rstrip(b"\0").decode(errors="replace"),
+		"flags": flags,
+		"sequence": sequence,
+		"uptime_s": uptime_s,
+		"temperatures": temperatures,
+	}
+
+
+def open_socket(interface):
+	sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+	sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+	if hasattr(socket, "SO_REUSEPORT"):
+		sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEPORT, 1)
+	sock.bind(("", PORT))
+	sock.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP,
+		socket.inet_aton(GROUP) + socket.inet_aton(interface))
+	sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_IF, socket.inet_aton(interface))
+	sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_LOOP, 1)
+	return sock
+
+
+def print_view(peers):
+	now = time.monotonic()
+	print(f"{'Hostname':16s} {'Address':15s} {'Age':>6s} {'Relay':5s} {'Door':6s} {'Alarm':5s} {'Lost':>5s} Temperatures")
+	for (address, _), peer in sorted(peers.items(), key=lambda item: item[0][1]):
+		flags = peer["flags"]
+		alarm = "new" if flags & FLAG_ALARM_UNACKNOWLEDGED else ("on" if flags & FLAG_ALARM else "-")
+		temperatures = " ".join("-" if value is None else f"{value:.2f}" for value in peer["temperatures"])
+		print(f"{peer['hostname']:16s} {address:15s} {now - peer['seen']:5.0f}s"
+			f" {'on' if flags & FLAG_RELAY else 'off':5s} {'open' if flags & FLAG_DOOR_OPEN else 'closed':6s}"
+			f" {alarm:5s} {peer['lost']:5d} {temperatures}")
+	print()
+
+
+def listen(args):
+	sock = open_socket(args.interface)
+	sock.settimeout(1)
+	peers = {}
+	last_print = 0
+
+	while True:
+		try:
+			frame, (address, _) = sock.recvfrom(1500)
+		except socket.timeout:
+			frame = None
+
+		now = time.monotonic()
+		status = decode(frame) if frame else None
+		if status:
+			key = (address, status["hostname"])
+			previous = peers.get(key)
+			status["lost"] = 0
+			if previous:
+				missing = (status["sequence"] - previous["sequence"] - 1) & 0xFFFFFFFF
+				# A restart starts the sequence again
+				if status["uptime_s"] >= previous["uptime_s"] and missing < 1000:
+					status["lost"] = previous["lost"] + missing
+			status["seen"] = now
+			peers[key] = status
+
+		for key in [key for key, peer in peers.items() if now - peer["seen"] >= PEER_TIMEOUT]:
+			del peers[key]
+
+		if now - last_print >= args.interval:
+			print_view(peers)
+			last_print = now
+
+
+def simulate(args):
+	sock = open_socket(args.interface)
+	start = time.monotonic()
+	nodes = []
+
+	for node in range(args.simulate):
+		sensors = [[random.getrandbits(48) << 8 | 0x28 << 56 | node, random.uniform(3, 5)] for _ in range(args.sensors)]
+		nodes.append({"hostname": f"{args.prefix}{node + 1}", "sequence": 0, "relay": False, "sensors": sensors})
+
+	while True:
+		for node in nodes:
+			for sensor in node["sensors"]:
+				sensor[1] += (-0.05 if node["relay"] else 0.02) + random.uniform(-0.01, 0.01)
+			mean = sum(sensor[1] for sensor in node["sensors"]) / len(node["sensors"])
+			if mean > 5:
+				node["relay"] = True
+			elif mean < 3:
+				node["relay"] = False
+
+			flags = FLAG_RELAY_AUTO | (FLAG_RELAY if node["relay"] else 0)
+			frame = encode(node["sequence"], int(time.monotonic() - start), node["hostname"], flags,
+				[(address, round(temperature * 16) / 16) for address, temperature in node["sensors"]])
+			sock.sendto(frame, (GROUP, PORT))
+			node["sequence"] += 1
+		time.sleep(args.interval)
+
+
+def main():
+	parser = argparse.ArgumentParser(description=__doc__)
+	parser.add_argument("-i", "--interface", default="0.0.0.0",
+		help="address of the interface to use (127.0.0.1 for loopback testing)")
+	parser.add_argument("-n", "--interval", type=float, default=10, help="seconds between updates")
+	parser.add_argument("-s", "--simulate", type=int, metavar="N", default=0,
+		help="send frames from N simulated controllers instead of listening")
+	parser.add_argument("--sensors", type=int, default=2, help="sensors for each simulated controller")
+	parser.add_argument("--prefix", default="sim-fridge-",
+		help="hostname prefix for simulated controllers (must be different for each instance)")
+	args = parser.parse_args()
+
+	if args.simulate:
+		simulate(args)
+	else:
+		listen(args)
+
+
+if __name__ == "__main__":
+	main()
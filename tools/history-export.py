@@ -0,0 +1,159 @@
+#!/usr/bin/env python3
+# fridge - Fridge Controller
+# Copyright 2022  Simon Arlott
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+"""Decode the output of the "export history" console command."""
+
+import argparse
+import base64
+import binascii
+import struct
+import sys
+
+BEGIN = "-----BEGIN FRIDGE HISTORY-----"
+END = "-----END FRIDGE HISTORY-----"
+
+FRAME_HEADER = 1
+FRAME_SAMPLES = 2
+FRAME_END = 3
+
+VERSION = 1
+
+
+def crc16(data):
+	crc = 0xFFFF
+	for value in data:
+		crc ^= value << 8
+		for _ in range(8):
+			crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+			crc &= 0xFFFF
+	return crc
+
+
+def read_frames(f):
+	"""Yield (type, payload) for each valid frame between the markers."""
+	active = False
+	for number, line in enumerate(f, 1):
+		line = line.strip()
+		if line == BEGIN:
+			active = True
+			continue
+		if line == END:
+			active = False
+			continue
+		if not active or not line:
+			continue
+
+		try:
+			frame = base64.b64decode(line, validate=True)
+		except binascii.Error:
+			print(f"Line {number}: invalid base64", file=sys.stderr)
+			continue
+
+		if len(frame) < 5:
+			print(f"Line {number}: frame too short", file=sys.stderr)
+			continue
+
+		frame_type, length = struct.unpack_from("<BH", frame)
+		if len(frame) != 3 + length + 2:
+			print(f"Line {number}: frame length mismatch", file=sys.stderr)
+			continue
+
+		(crc,) = struct.unpack_from("<H", frame, 3 + length)
+		if crc != crc16(frame[:3 + length]):
+			print(f"Line {number}: frame CRC mismatch", file=sys.stderr)
+			continue
+
+		yield frame_type, frame[3:3 + length]
+
+
+def varint(data, offset):
+	value = 0
+	shift = 0
+	while True:
+		byte = data[offset]
+		offset += 1
+		value |= (byte & 0x7F) << shift
+		if not byte & 0x80:
+			return value, offset
+		shift += 7
+
+
+def sensor_id(address):
+	return (f"{(address >> 56) & 0xFF:02X}-{(address >> 40) & 0xFFFF:04X}-"
+		f"{(address >> 24) & 0xFFFF:04X}-{(address >> 8) & 0xFFFF:04X}-{address & 0xFF:02X}")
+
+
+def decode(f):
+	"""Yield (uptime_s, time_s or None, sensor, temperature_c) for each sample."""
+	header = None
+
+	for frame_type, payload in read_frames(f):
+		if frame_type == FRAME_HEADER:
+			version, uptime_s, now_s, interval_s, count = struct.unpack_from("<BIIHB", payload)
+			if version != VERSION:
+				raise ValueError(f"Unsupported version {version}")
+			devices = struct.unpack_from(f"<{count}Q", payload, 12)
+			header = (uptime_s, now_s, [sensor_id(device) for device in devices])
+		elif frame_type == FRAME_SAMPLES:
+			if header is None:
+				print("Samples before header", file=sys.stderr)
+				continue
+
+			export_uptime_s, export_time_s, devices = header
+			offset = 0
+			uptime_s = 0
+			temperature = {}
+
+			while offset < len(payload):
+				device = payload[offset]
+				offset += 1
+				delta, offset = varint(payload, offset)
+				change, offset = varint(payload, offset)
+				change = (change >> 1) ^ -(change & 1)
+
+				uptime_s += delta
+				temperature[device] = temperature.get(device, 0) + change
+
+				# Samples from before a restart can't be exported, so the
+				# uptime can be converted using the time of the export
+				time_s = export_time_s - (export_uptime_s - uptime_s) if export_time_s else None
+				yield uptime_s, time_s, devices[device], temperature[device] / 16
+		elif frame_type == FRAME_END:
+			count, lost = struct.unpack_from("<II", payload)
+			print(f"{count} samples exported, {lost} overwritten during export", file=sys.stderr)
+
+
+def main():
+	parser = argparse.ArgumentParser(description=__doc__)
+	parser.add_argument("file", nargs="?", type=argparse.FileType("r"), default=sys.stdin)
+	parser.add_argument("-f", "--format", choices=["csv", "influx"], default="csv",
+		help="output CSV or InfluxDB line protocol (requires the time to be known)")
+	parser.add_argument("-m", "--measurement", default="fridge", help="InfluxDB measurement name")
+	args = parser.parse_args()
+
+	if args.format == "csv":
+		print("uptime_s,time_s,sensor,temperature_c")
+
+	for uptime_s, time_s, sensor, temperature_c in decode(args.file):
+		if args.format == "csv":
+			print(f"{uptime_s},{time_s if time_s is not None else ''},{sensor},{temperature_c:.4f}")
+		elif time_s is not None:
+			print(f"{args.measurement},sensor={sensor} temperature={temperature_c:.4f} {time_s}000000000")
+
+
+if __name__ == "__main__":
+	main()